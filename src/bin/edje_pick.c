@@ -2,19 +2,1972 @@
 # include "config.h"
 #endif
 
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <regex.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <Eina.h>
+#include <Eet.h>
+#include <Edje.h>
+
 #include "Edje_Pick.h"
+#include "edje_pick_private.h"
+#include "edje_pick_plan.h"
+#include "edje_pick_eet.h"
+
+/* Driver entry recording what an output was built from */
+#define EDJE_PICK_STATE_ENTRY   "edje_pick/state"
+#define EDJE_PICK_STATE_VERSION "edje_pick-state 1"
+
+/* --cache entries are DIR/<key hash>.edj with the full key in .key */
+#define EDJE_PICK_CACHE_VERSION "edje_pick-cache 1"
+
+/* Defaults of --recompress */
+#define EDJE_PICK_IMAGE_QUALITY  90
+#define EDJE_PICK_IMAGE_COMPRESS 9
+
+/* Input bytes mapped at a time when hashing under --max-mem */
+#define EDJE_PICK_HASH_WINDOW (1024 * 1024)
+
+#define EDJE_PICK_DRIVER_USAGE \
+   "Driver options:\n" \
+   "  --jobs N          Worker threads prefetching the inputs and running\n" \
+   "                    the passes after the merge (0: one per CPU); the\n" \
+   "                    merge itself is single-threaded\n" \
+   "  --manifest FILE   Build every output listed in FILE, one edje_pick\n" \
+   "                    command line per line (without program name)\n" \
+   "  --skip-up-to-date Up-to-date check: skip the build when arguments\n" \
+   "                    and input contents match what the existing output\n" \
+   "                    was built from; nothing of the old output is\n" \
+   "                    reused, any change builds it all again\n" \
+   "  --dedup           Store identical images, samples and fonts once\n" \
+   "  --daemon NAME     Serve requests on local socket NAME, keeping the\n" \
+   "                    context and opened inputs warm between runs\n" \
+   "  --connect NAME    Forward this command line to daemon NAME\n" \
+   "                    (default from $" EDJE_PICK_DAEMON_ENV ")\n" \
+   "  --stats=json      Print per-phase timings and counters as JSON\n" \
+   "  --max-mem SIZE    Limit for the passes after the merge only: bound\n" \
+   "                    the memory they hold to SIZE bytes (K, M, G\n" \
+   "                    suffixes). The merge is not bounded, nor are the\n" \
+   "                    --scales variants waiting to be stored; output is\n" \
+   "                    unchanged\n" \
+   "  --dry-run         Check the selection for conflicts and estimate the\n" \
+   "                    output size, without writing anything\n" \
+   "  --recompress      Encode images again, in parallel, keeping the new\n" \
+   "                    encoding when it is smaller\n" \
+   "  --image-quality Q Lossy quality for --recompress (1-100, default 90)\n" \
+   "  --image-compress N\n" \
+   "                    Lossless level for --recompress (0-9, default 9)\n" \
+   "  --lossy-min N     With --recompress, images of N pixels or more are\n" \
+   "                    encoded lossy, smaller ones lossless (default:\n" \
+   "                    keep the encoding of each image)\n" \
+   "  --reproducible    Write entries in a canonical order so the same\n" \
+   "                    inputs give a byte-identical output; the output\n" \
+   "                    mtime is set from $" EDJE_PICK_SOURCE_DATE_ENV "\n" \
+   "  --watch           Stay running and rebuild the outputs whose inputs\n" \
+   "                    are rewritten, until interrupted; each rebuild\n" \
+   "                    merges the whole output again, not only the\n" \
+   "                    groups that changed\n" \
+   "  --cache DIR       Keep outputs in DIR keyed by arguments and input\n" \
+   "                    contents, and serve repeated builds from there\n" \
+   "  --gc              Drop images, samples and fonts no output group\n" \
+   "                    uses; ones only named from scripts are not seen\n" \
+   "  @FILE             Read more arguments from FILE, one per line\n" \
+   "  --groups-from FILE\n" \
+   "                    Take the groups named in FILE (- for stdin, not\n" \
+   "                    in daemon requests), one per line, from the last\n" \
+   "                    -i input; repeats are dropped. With @FILE too,\n" \
+   "                    every name is kept in memory until the merge is\n" \
+   "                    done, so memory grows with the selection size\n" \
+   "  --verify          Load every output group and decode the images,\n" \
+   "                    samples and fonts it uses, in parallel\n" \
+   "  --split DIR       Write each group of the inputs to its own file\n" \
+   "                    DIR/<group>.edj with the resources it uses, in\n" \
+   "                    parallel; -o is not used\n" \
+   "  --split-depth N   With --split, one file per group name prefix of\n" \
+   "                    N '/' separated parts instead\n" \
+   "  -g PATTERN        A group name with *, ? or [ is a glob ('*' also\n" \
+   "                    matches '/') taking every matching group of the\n" \
+   "                    last -i input\n" \
+   "  --group-regex RE  Take every group of the last -i input matching\n" \
+   "                    extended regular expression RE; a group named or\n" \
+   "                    matched more than once is taken once\n" \
+   "  --scales LIST     Add downscaled variants of each image, at the\n" \
+   "                    comma separated scales in LIST (0 < scale < 1, at\n" \
+   "                    most 4), and show them through image sets so the\n" \
+   "                    closest size is drawn; needs edje 1.18\n" \
+   "  --opaque          Store lossless images whose pixels are all opaque\n" \
+   "                    without alpha; with --recompress, lossy ones too\n" \
+   "  --trace-report FILE\n" \
+   "                    Report the pages of the output that loading the\n" \
+   "                    resources in FILE touches, and the possible\n" \
+   "                    reduction if they were laid out together. FILE\n" \
+   "                    lists one per line as 'group NAME', 'image NAME',\n" \
+   "                    'sample NAME', 'font NAME' or an eet entry name;\n" \
+   "                    eet places entries by name hash, so the output is\n" \
+   "                    unchanged and the reduction is not achieved\n"
+
+static const char *_edje_pick_phase_names[EDJE_PICK_PHASE_LAST] = {
+     "parse", "open", "merge", "gc", "scale", "opaque",
+     "recompress", "dedup", "trace", "verify",
+     "canonical", "state", "cache"
+};
+
+typedef struct _Edje_Pick_Spec Edje_Pick_Spec;
+struct _Edje_Pick_Spec
+{  /* One output of a manifest */
+   char *line;            /* argv tokens point into it */
+   char **argv;
+   int argc;
+   unsigned int lineno;
+   Edje_Pick_Opts opts;
+};
+
+typedef struct _Edje_Pick_Jobs Edje_Pick_Jobs;
+struct _Edje_Pick_Jobs
+{
+   Edje_Pick_Job_Cb func;
+   void *data;
+   unsigned int count;
+   unsigned int next;   /* Next index to hand out, under lock */
+   Eina_Lock lock;
+};
+
+double
+_edje_pick_time_get(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec + (t.tv_nsec / 1000000000.0);
+}
+
+void
+_edje_pick_stats_phase_add(Edje_Pick_Stats *st, Edje_Pick_Phase ph,
+      double t0)
+{  /* Account time since t0 to phase */
+   if (st)
+     st->phase[ph] += _edje_pick_time_get() - t0;
+}
+
+static unsigned int
+_edje_pick_entries_count(Eet_File *ef, const char *glob)
+{
+   char **names;
+   int n = 0;
+
+   names = eet_list(ef, glob, &n);
+   free(names);
+   return n;
+}
+
+void
+_edje_pick_stats_output_add(Edje_Pick_Stats *st, const char *output)
+{  /* Count what a built output contains */
+   Eina_File *f;
+   Eet_File *ef;
+
+   st->outputs++;
+   f = eina_file_open(output, EINA_FALSE);
+   if (f)
+     {
+        st->bytes_written += eina_file_size_get(f);
+        eina_file_close(f);
+     }
+
+   ef = eet_open(output, EET_FILE_MODE_READ);
+   if (!ef)
+     return;
+
+   st->groups += _edje_pick_entries_count(ef, EDJE_PICK_GROUPS_GLOB);
+   st->images += _edje_pick_entries_count(ef, EDJE_PICK_IMAGES_GLOB);
+   st->samples += _edje_pick_entries_count(ef, EDJE_PICK_SAMPLES_GLOB);
+   st->fonts += _edje_pick_entries_count(ef, EDJE_PICK_FONTS_GLOB);
+   eet_close(ef);
+}
+
+void
+_edje_pick_report(const Edje_Pick_Opts *o, const char *fmt, ...)
+{  /* Summary line of a pass, left out when --stats prints the counters */
+   va_list ap;
+
+   if (o->stats)
+     return;
+
+   va_start(ap, fmt);
+   vprintf(fmt, ap);
+   va_end(ap);
+}
+
+static void
+_edje_pick_stats_print(const Edje_Pick_Stats *st, int status)
+{  /* One JSON object on stdout, keys are stable across versions */
+   unsigned int i;
+
+   printf("{\"version\": 1, \"status\": %d, ", status);
+   printf("\"time\": {");
+   for (i = 0; i < EDJE_PICK_PHASE_LAST; i++)
+     printf("\"%s\": %.6f, ", _edje_pick_phase_names[i], st->phase[i]);
+
+   printf("\"total\": %.6f}, ", _edje_pick_time_get() - st->start);
+   printf("\"bytes\": {\"read\": %llu, \"written\": %llu, "
+         "\"dedup_saved\": %llu, \"recompress_saved\": %llu, "
+         "\"gc_removed\": %llu}, ",
+         st->bytes_read, st->bytes_written, st->dedup_saved,
+         st->recompress_saved, st->gc_removed);
+   printf("\"counts\": {\"inputs\": %u, \"outputs\": %u, "
+         "\"skipped\": %u, \"recompressed\": %u, "
+         "\"cache_hits\": %u, \"cache_misses\": %u, \"collected\": %u, "
+         "\"verified\": %u, \"problems\": %u, "
+         "\"scaled\": %u, \"opaque\": %u, \"trace_pages\": %u, "
+         "\"trace_pages_packed\": %u}, ",
+         st->inputs, st->outputs, st->skipped, st->recompressed,
+         st->cache_hits, st->cache_misses, st->collected,
+         st->verified, st->problems, st->scaled,
+         st->opaque, st->trace_pages, st->trace_pages_packed);
+   printf("\"entries\": {\"groups\": %u, \"images\": %u, "
+         "\"samples\": %u, \"fonts\": %u}}\n",
+         st->groups, st->images, st->samples, st->fonts);
+   fflush(stdout);
+}
+
+static void *
+_edje_pick_jobs_thread(void *data, Eina_Thread t EINA_UNUSED)
+{  /* Worker loop, takes the next free index until all are done */
+   Edje_Pick_Jobs *j = data;
+   unsigned int idx;
+
+   for (;;)
+     {
+        eina_lock_take(&j->lock);
+        idx = j->next++;
+        eina_lock_release(&j->lock);
+
+        if (idx >= j->count)
+          break;
+
+        j->func(j->data, idx);
+     }
+
+   return NULL;
+}
+
+void
+_edje_pick_jobs_run(unsigned int jobs, unsigned int count,
+      Edje_Pick_Job_Cb func, void *data)
+{  /* Call func for each index in [0, count) using up to 'jobs' threads.
+      The calling thread is one of them. Results must be stored by index
+      so the outcome does not depend on scheduling. */
+   Edje_Pick_Jobs j;
+   Eina_Thread *t;
+   unsigned int n, i;
+
+   if (!count)
+     return;
+
+   if (!jobs)
+     jobs = eina_cpu_count();
+
+   n = (jobs < count) ? jobs : count;
+   j.func = func;
+   j.data = data;
+   j.count = count;
+   j.next = 0;
+   eina_lock_new(&j.lock);
+
+   t = calloc(n, sizeof(Eina_Thread));
+   if (!t)
+     n = 1;  /* Then all of it runs on this thread */
+
+   for (i = 1; i < n; i++)
+     {  /* Fewer threads than asked is fine, the loop shares the work */
+        if (!eina_thread_create(&t[i], EINA_THREAD_NORMAL, -1,
+                 _edje_pick_jobs_thread, &j))
+          break;
+     }
+
+   n = i;
+   _edje_pick_jobs_thread(&j, 0);
+   for (i = 1; i < n; i++)
+     eina_thread_join(t[i]);
+
+   free(t);
+   eina_lock_free(&j.lock);
+}
+
+static void
+_edje_pick_budget_init(Edje_Pick_Budget *b, unsigned long long max)
+{
+   b->max = max;
+   b->used = 0;
+   eina_lock_new(&b->lock);
+   eina_condition_new(&b->cond, &b->lock);
+}
+
+static void
+_edje_pick_budget_shutdown(Edje_Pick_Budget *b)
+{
+   eina_condition_free(&b->cond);
+   eina_lock_free(&b->lock);
+}
+
+void
+_edje_pick_budget_take(Edje_Pick_Budget *b, unsigned long long size)
+{  /* Block until size fits. A request larger than the whole budget is
+      let through alone, so a single big entry can't deadlock. */
+   if (!b)
+     return;
+
+   eina_lock_take(&b->lock);
+   while (b->used && ((b->used + size) > b->max))
+     eina_condition_wait(&b->cond);
+
+   b->used += size;
+   eina_lock_release(&b->lock);
+}
+
+void
+_edje_pick_budget_release(Edje_Pick_Budget *b, unsigned long long size)
+{
+   if (!b)
+     return;
+
+   eina_lock_take(&b->lock);
+   b->used -= size;
+   eina_condition_broadcast(&b->cond);
+   eina_lock_release(&b->lock);
+}
+
+#define EDJE_PICK_HASH_INIT 14695981039346656037ULL
+
+static unsigned long long
+_edje_pick_hash_update(unsigned long long h, const unsigned char *p,
+      size_t size)
+{  /* FNV-1a variant taking 8 bytes per round, for change detection.
+      Can be fed in pieces, all but the last a multiple of 8 bytes. */
+   unsigned long long w;
+   size_t i;
+
+   for (i = 0; (i + sizeof(w)) <= size; i += sizeof(w))
+     {
+        memcpy(&w, p + i, sizeof(w));
+        h = (h ^ w) * 1099511628211ULL;
+     }
+
+   for (; i < size; i++)
+     h = (h ^ p[i]) * 1099511628211ULL;
+
+   return h;
+}
+
+unsigned long long
+_edje_pick_hash(const unsigned char *p, size_t size)
+{
+   return _edje_pick_hash_update(EDJE_PICK_HASH_INIT, p, size) ^ size;
+}
+
+static Eina_Bool
+_edje_pick_file_hash(Edje_Pick_Input *in, Edje_Pick_Budget *b)
+{  /* Same result as _edje_pick_hash() on the whole file, mapping one
+      window at a time so at most a window per worker is resident */
+   unsigned long long h = EDJE_PICK_HASH_INIT;
+   size_t off, len;
+   void *map;
+
+   for (off = 0; off < in->size; off += len)
+     {
+        len = in->size - off;
+        if (len > EDJE_PICK_HASH_WINDOW)
+          len = EDJE_PICK_HASH_WINDOW;
+
+        _edje_pick_budget_take(b, len);
+        map = eina_file_map_new(in->f, EINA_FILE_SEQUENTIAL, off, len);
+        if (map)
+          {
+             h = _edje_pick_hash_update(h, map, len);
+             eina_file_map_free(in->f, map);
+          }
+
+        _edje_pick_budget_release(b, len);
+        if (!map)
+          return EINA_FALSE;
+     }
+
+   in->hash = h ^ in->size;
+   return EINA_TRUE;
+}
+
+static Eina_Bool
+_edje_pick_opts_hashing(const Edje_Pick_Opts *o)
+{  /* Input contents are needed by --skip-up-to-date and --cache */
+   return (o->up_to_date || o->cache);
+}
+
+static void
+_edje_pick_input_stage(void *data, unsigned int idx)
+{  /* Prefetch one input: map and fault it in, eet_open() later gets the
+      same Eina_File */
+   Edje_Pick_Opts *o = data;
+   Edje_Pick_Input *in = &o->inputs[idx];
+
+   in->f = eina_file_open(in->name, EINA_FALSE);
+   if (!in->f)
+     return;  /* edje_pick_process() reports missing inputs */
+
+   in->size = eina_file_size_get(in->f);
+   if (o->budget)
+     {  /* Don't fault-in whole inputs, eet pages in what the merge reads */
+        if (_edje_pick_opts_hashing(o))
+          in->hashed = _edje_pick_file_hash(in, o->budget);
+
+        return;
+     }
+
+   in->map = eina_file_map_all(in->f, EINA_FILE_POPULATE);
+   if (in->map && _edje_pick_opts_hashing(o))
+     {  /* Hash while pages are hot, on this worker */
+        in->hash = _edje_pick_hash(in->map, in->size);
+        in->hashed = EINA_TRUE;
+     }
+}
+
+void
+_edje_pick_inputs_stage(Edje_Pick_Opts *o)
+{
+   double t0 = _edje_pick_time_get();
+   unsigned int i;
+
+   _edje_pick_jobs_run(o->jobs, o->inputs_count, _edje_pick_input_stage, o);
+   if (!o->stats)
+     return;
+
+   _edje_pick_stats_phase_add(o->stats, EDJE_PICK_PHASE_OPEN, t0);
+   o->stats->inputs += o->inputs_count;
+   for (i = 0; i < o->inputs_count; i++)
+     o->stats->bytes_read += o->inputs[i].size;
+}
+
+void
+_edje_pick_inputs_release(Edje_Pick_Opts *o)
+{
+   unsigned int i;
+
+   for (i = 0; i < o->inputs_count; i++)
+     {
+        Edje_Pick_Input *in = &o->inputs[i];
+        if (in->map)
+          eina_file_map_free(in->f, in->map);
+
+        if (in->f)
+          eina_file_close(in->f);
+
+        in->map = NULL;
+        in->f = NULL;
+     }
+}
+
+void
+_edje_pick_state_add(Edje_Pick_Opts *o, Eet_File *ef)
+{  /* Add the pending state entry to an output being written anyway */
+   if (!o->state)
+     return;
+
+   if (eet_write(ef, EDJE_PICK_STATE_ENTRY, o->state, strlen(o->state) + 1,
+            EET_COMPRESSION_DEFAULT) > 0)
+     {
+        free(o->state);
+        o->state = NULL;
+     }
+}
+
+void
+_edje_pick_output_close(Edje_Pick_Opts *o, Eet_File *ef)
+{  /* Close the output after a pass opened it to write, the state entry
+      goes in with what the pass wrote */
+   _edje_pick_state_add(o, ef);
+   eet_close(ef);
+}
+
+static void
+_edje_pick_inputs_share(const Edje_Pick_Opts *from, Edje_Pick_Opts *to)
+{  /* Copy content hashes of inputs staged by 'from' into 'to' */
+   unsigned int i, j;
+
+   for (i = 0; i < to->inputs_count; i++)
+     for (j = 0; j < from->inputs_count; j++)
+       if (to->inputs[i].name == from->inputs[j].name)
+         {  /* stringshare, pointer compare is enough */
+            to->inputs[i].size = from->inputs[j].size;
+            to->inputs[i].hash = from->inputs[j].hash;
+            to->inputs[i].hashed = from->inputs[j].hashed;
+            break;
+         }
+}
+
+static char *
+_edje_pick_state_make(const Edje_Pick_Opts *o)
+{  /* Describe arguments and input contents, NULL if an input is missing */
+   Eina_Strbuf *buf;
+   unsigned int i;
+   int a;
+
+   for (i = 0; i < o->inputs_count; i++)
+     if (!o->inputs[i].hashed)
+       return NULL;
+
+   buf = eina_strbuf_new();
+   eina_strbuf_append(buf, EDJE_PICK_STATE_VERSION "\n");
+   for (a = 1; a < o->argc; a++)
+     eina_strbuf_append_printf(buf, "arg %s\n", o->argv[a]);
+
+   for (i = 0; i < o->inputs_count; i++)
+     eina_strbuf_append_printf(buf, "input %016llx %zu %s\n",
+           o->inputs[i].hash, o->inputs[i].size, o->inputs[i].name);
+
+   return eina_strbuf_string_steal(buf);
+}
+
+static Eina_Bool
+_edje_pick_state_up_to_date(const char *output, const char *state)
+{  /* Check if output was built from exactly this state */
+   Eina_Bool ret = EINA_FALSE;
+   Eet_File *ef;
+   char *prev;
+   int size;
+
+   ef = eet_open(output, EET_FILE_MODE_READ);
+   if (!ef)
+     return EINA_FALSE;
+
+   prev = eet_read(ef, EDJE_PICK_STATE_ENTRY, &size);
+   if (prev && (size == (int) strlen(state) + 1))
+     ret = !memcmp(prev, state, size);
+
+   free(prev);
+   eet_close(ef);
+   return ret;
+}
+
+static void
+_edje_pick_input_add(Edje_Pick_Opts *o, const char *name)
+{  /* Record distinct input file names, keep argv order */
+   Edje_Pick_Input *tmp;
+   unsigned int i;
+
+   for (i = 0; i < o->inputs_count; i++)
+     if (!strcmp(o->inputs[i].name, name))
+       return;
+
+   tmp = realloc(o->inputs, (o->inputs_count + 1) * sizeof(Edje_Pick_Input));
+   if (!tmp)
+     return;
+
+   o->inputs = tmp;
+   memset(&o->inputs[o->inputs_count], 0, sizeof(Edje_Pick_Input));
+   o->inputs[o->inputs_count].name = eina_stringshare_add(name);
+   o->inputs_count++;
+}
+
+const char *
+_edje_pick_opt_value(const char *opt, int argc, char **argv, int *i)
+{  /* Returns value of "--opt=VAL" or "--opt VAL", NULL if argv[*i] is
+      not opt. Advances *i when value is taken from next arg. */
+   size_t len = strlen(opt);
+
+   if (strncmp(argv[*i], opt, len))
+     return NULL;
+
+   if (argv[*i][len] == '=')
+     return argv[*i] + len + 1;
+
+   if (argv[*i][len] != '\0')
+     return NULL;
+
+   if ((*i + 1) < argc)
+     return argv[++(*i)];
+
+   return "";  /* Option given without value */
+}
+
+Eina_Bool
+_edje_pick_lib_opt_valued(const char *arg)
+{  /* edje_pick_process() options whose value is the next argument */
+   return (!strcmp(arg, "-i") || !strcmp(arg, "-a") ||
+         !strcmp(arg, "-g") || !strcmp(arg, "-o"));
+}
+
+static Eina_Bool
+_edje_pick_size_parse(const char *v, unsigned long long *size)
+{  /* Byte count with optional K, M or G (powers of 1024) suffix */
+   unsigned long long n;
+   unsigned int shift = 0;
+   char *end;
+
+   if ((*v < '0') || (*v > '9'))
+     return EINA_FALSE;
+
+   errno = 0;
+   n = strtoull(v, &end, 10);
+   if (errno == ERANGE)
+     return EINA_FALSE;
+
+   switch (*end)
+     {  /* Each suffix falls through to the smaller ones */
+      case 'G':
+      case 'g':
+         shift += 10;
+         /* Fall through */
+      case 'M':
+      case 'm':
+         shift += 10;
+         /* Fall through */
+      case 'K':
+      case 'k':
+         shift += 10;
+         end++;
+         break;
+      default:
+         break;
+     }
+
+   if ((*end) || (n > (ULLONG_MAX >> shift)))
+     return EINA_FALSE;
+
+   n <<= shift;
+
+   *size = n;
+   return EINA_TRUE;
+}
+
+static Eina_Bool
+_edje_pick_uint_parse(const char *opt, const char *v,
+      unsigned int min, unsigned int max, unsigned int *ret)
+{  /* Decimal value of opt in [min, max], logs an error otherwise */
+   unsigned long n;
+   char *end;
+
+   n = strtoul(v, &end, 10);
+   if ((*v < '0') || (*v > '9') || (*end) || (n < min) || (n > max))
+     {
+        EINA_LOG_ERR("Invalid value '%s' for %s\n", v, opt);
+        return EINA_FALSE;
+     }
+
+   *ret = n;
+   return EINA_TRUE;
+}
+
+static Eina_Bool
+_edje_pick_scales_parse(Edje_Pick_Opts *o, const char *v)
+{  /* Comma separated scales, each in (0, 1) */
+   const char *p = v;
+   double scale;
+   char *end;
+
+   o->scales_count = 0;
+   do
+     {
+        scale = strtod(p, &end);
+        if ((end == p) || ((*end) && (*end != ',')) || (scale <= 0.0) ||
+            (scale >= 1.0) || (o->scales_count == EDJE_PICK_SCALES_MAX))
+          {
+             EINA_LOG_ERR("Invalid value '%s' for %s\n",
+                   v, EDJE_PICK_OPT_SCALES);
+             return EINA_FALSE;
+          }
+
+        o->scales[o->scales_count++] = scale;
+        p = end + 1;
+     }
+   while (*end);
+
+   return EINA_TRUE;
+}
+
+static void
+_edje_pick_arg_add(char ***argv, int *argc, unsigned int *size, char *arg)
+{  /* Append arg, doubling the array as needed. Kept NULL terminated. */
+   if ((unsigned int) (*argc + 1) >= *size)
+     {
+        *size = (*size < 16) ? 16 : (*size * 2);
+        *argv = realloc(*argv, *size * sizeof(char *));
+     }
+
+   (*argv)[(*argc)++] = arg;
+   (*argv)[*argc] = NULL;
+}
+
+Eina_Bool
+_edje_pick_lines_read(const char *file, Edje_Pick_Line_Cb func, void *data)
+{  /* Call func for each line of file ("-" for stdin) without its end,
+      skipping blank and comment lines. Only one line is held at a time. */
+   FILE *fp = strcmp(file, "-") ? fopen(file, "r") : stdin;
+   char *line = NULL;
+   size_t len = 0;
+   ssize_t n;
+
+   if (!fp)
+     {
+        EINA_LOG_ERR("Failed to open list '%s'\n", file);
+        return EINA_FALSE;
+     }
+
+   while ((n = getline(&line, &len, fp)) >= 0)
+     {
+        while ((n > 0) && ((line[n - 1] == '\n') || (line[n - 1] == '\r')))
+          line[--n] = '\0';
+
+        if ((n > 0) && (*line != '#'))
+          func(data, line);
+     }
+
+   free(line);
+   if (fp != stdin)
+     fclose(fp);
+
+   return EINA_TRUE;
+}
+
+typedef struct _Edje_Pick_Args Edje_Pick_Args;
+struct _Edje_Pick_Args
+{  /* Arguments being expanded from @FILE */
+   Edje_Pick_Opts *o;
+   char **argv;
+   int argc;
+   unsigned int size;
+};
+
+static void
+_edje_pick_args_line(void *data, const char *line)
+{
+   Edje_Pick_Args *a = data;
+   const char *arg = eina_stringshare_add(line);
+
+   a->o->strings = eina_list_append(a->o->strings, arg);
+   _edje_pick_arg_add(&a->argv, &a->argc, &a->size, (char *) arg);
+}
+
+static Eina_Bool
+_edje_pick_args_expand(Edje_Pick_Opts *o, int *argc, char ***argv)
+{  /* Replace each @FILE argument by the lines of FILE, once, as nested
+      @FILE lines are taken as they are. argv is left alone if none. */
+   Edje_Pick_Args a;
+   int i;
+
+   for (i = 1; i < *argc; i++)
+     if (((*argv)[i][0] == '@') && (*argv)[i][1])
+       break;
+
+   if (i == *argc)
+     return EINA_TRUE;
+
+   memset(&a, 0, sizeof(a));
+   a.o = o;
+   for (i = 0; i < *argc; i++)
+     {
+        if ((i > 0) && ((*argv)[i][0] == '@') && (*argv)[i][1])
+          {
+             if (!_edje_pick_lines_read((*argv)[i] + 1,
+                      _edje_pick_args_line, &a))
+               {
+                  free(a.argv);
+                  return EINA_FALSE;
+               }
+
+             continue;
+          }
+
+        _edje_pick_arg_add(&a.argv, &a.argc, &a.size, (*argv)[i]);
+     }
+
+   o->args = a.argv;
+   *argc = a.argc;
+   *argv = a.argv;
+   return EINA_TRUE;
+}
+
+typedef struct _Edje_Pick_Pattern Edje_Pick_Pattern;
+struct _Edje_Pick_Pattern
+{  /* Group pattern, compiled when given */
+   const char *text;   /* As given, glob when not a regex */
+   Eina_Bool regex;
+   regex_t re;
+   unsigned int hits;
+};
+
+static void
+_edje_pick_pattern_free(Edje_Pick_Pattern *pt)
+{
+   if (pt->regex)
+     regfree(&pt->re);
+
+   free(pt);
+}
+
+static Eina_Bool
+_edje_pick_pattern_add(Edje_Pick_Opts *o, const char *text, Eina_Bool regex)
+{
+   Edje_Pick_Pattern *pt = calloc(1, sizeof(Edje_Pick_Pattern));
+   char err[256];
+   int e;
+
+   pt->text = text;
+   pt->regex = regex;
+   if (regex && (e = regcomp(&pt->re, text, REG_EXTENDED | REG_NOSUB)))
+     {
+        regerror(e, &pt->re, err, sizeof(err));
+        EINA_LOG_ERR("Invalid %s '%s': %s\n",
+              EDJE_PICK_OPT_GROUP_REGEX, text, err);
+        free(pt);
+        return EINA_FALSE;
+     }
+
+   o->patterns = eina_list_append(o->patterns, pt);
+   return EINA_TRUE;
+}
+
+typedef struct _Edje_Pick_Groups_From Edje_Pick_Groups_From;
+struct _Edje_Pick_Groups_From
+{
+   Edje_Pick_Opts *o;
+   const char *input;   /* Where the groups are taken from */
+};
+
+static void
+_edje_pick_groups_line(void *data, const char *line)
+{  /* Add "-g line" unless line was already listed for the same input.
+      Names are stringshare, so the set is keyed by pointer. */
+   Edje_Pick_Groups_From *gf = data;
+   Edje_Pick_Opts *o = gf->o;
+   const char *name = eina_stringshare_add(line);
+   const char *in = eina_hash_find(o->listed, name);
+
+   if (in == gf->input)
+     {
+        eina_stringshare_del(name);
+        return;
+     }
+
+   if (!in)  /* Else let the merge report it as a duplicate */
+     eina_hash_add(o->listed, name, gf->input);
+
+   o->strings = eina_list_append(o->strings, name);
+   _edje_pick_arg_add(&o->argv, &o->argc, &o->argv_size, "-g");
+   _edje_pick_arg_add(&o->argv, &o->argc, &o->argv_size, (char *) name);
+}
+
+static Edje_Pick_Status
+_edje_pick_patterns_expand(Edje_Pick_Opts *o, const char *input)
+{  /* Add the groups of input matching the pending patterns, in directory
+      order. The directory is listed once whatever the number of patterns
+      and each name is tested against all of them in the same pass, so
+      every pattern gets its hits. */
+   Edje_Pick_Groups_From gf = { o, input };
+   Edje_Pick_Status status = EDJE_PICK_NO_ERROR;
+   Edje_Pick_Pattern *pt;
+   Eina_List *groups, *l, *ll;
+   const char *group;
+   Eina_Bool matched;
+
+   if (!o->patterns)
+     return EDJE_PICK_NO_ERROR;
+
+   edje_init();
+   groups = edje_file_collection_list(input);
+   EINA_LIST_FOREACH(groups, l, group)
+     {
+        matched = EINA_FALSE;
+        EINA_LIST_FOREACH(o->patterns, ll, pt)
+          if (!(pt->regex ? regexec(&pt->re, group, 0, NULL, 0) :
+                   fnmatch(pt->text, group, 0)))
+            {
+               pt->hits++;
+               matched = EINA_TRUE;
+            }
+
+        if (matched)  /* Once, and not again if named exactly */
+          _edje_pick_groups_line(&gf, group);
+     }
+
+   edje_file_collection_list_free(groups);
+   edje_shutdown();
+   EINA_LIST_FREE(o->patterns, pt)
+     {
+        if (!pt->hits)
+          {  /* As a missing group named exactly would be */
+             EINA_LOG_ERR("No group of '%s' matches '%s'\n",
+                   input, pt->text);
+             status = EDJE_PICK_GROUP_MISSING;
+          }
+
+        _edje_pick_pattern_free(pt);
+     }
+
+   return status;
+}
+
+static Edje_Pick_Status
+_edje_pick_opts_parse(Edje_Pick_Opts *o, int argc, char **argv,
+      const Edje_Pick_Opts *base)
+{  /* Strip driver options, keep the rest for edje_pick_process().
+      Flags not given here are taken from base when not NULL, o->served
+      is set by the caller otherwise. */
+   const char *input = NULL;  /* Last -i, for --groups-from and patterns */
+   Eina_Bool served = base ? base->served : o->served;
+   Edje_Pick_Status s;
+   const char *v;
+   int i;
+
+   memset(o, 0, sizeof(*o));
+   o->served = served;
+   o->image_quality = EDJE_PICK_IMAGE_QUALITY;
+   o->image_compress = EDJE_PICK_IMAGE_COMPRESS;
+   if (base)
+     {
+        o->jobs = base->jobs;
+        o->up_to_date = base->up_to_date;
+        o->dedup = base->dedup;
+        o->stats = base->stats;
+        o->max_mem = base->max_mem;
+        o->budget = base->budget;
+        o->dry_run = base->dry_run;
+        o->recompress = base->recompress;
+        o->opaque = base->opaque;
+        o->image_quality = base->image_quality;
+        o->image_compress = base->image_compress;
+        o->lossy_min = base->lossy_min;
+        o->reproducible = base->reproducible;
+        o->watch = base->watch;
+        o->cache = base->cache;
+        o->gc = base->gc;
+        o->verify = base->verify;
+        o->split_depth = base->split_depth;
+        o->trace = base->trace;
+        memcpy(o->scales, base->scales, sizeof(o->scales));
+        o->scales_count = base->scales_count;
+     }
+   if (!_edje_pick_args_expand(o, &argc, &argv))
+     return EDJE_PICK_PARSE_FAILED;
+
+   o->listed = eina_hash_stringshared_new(NULL);
+   _edje_pick_arg_add(&o->argv, &o->argc, &o->argv_size, argv[0]);
+
+   for (i = 1; i < argc; i++)
+     {
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_JOBS, argc, argv, &i)))
+          {
+             char *end;
+             long n = strtol(v, &end, 10);
+             if ((!*v) || (*end) || (n < 0))
+               {
+                  EINA_LOG_ERR("Invalid value '%s' for %s\n",
+                        v, EDJE_PICK_OPT_JOBS);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             o->jobs = n;
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_IMAGE_QUALITY,
+                    argc, argv, &i)))
+          {
+             if (!_edje_pick_uint_parse(EDJE_PICK_OPT_IMAGE_QUALITY, v,
+                      1, 100, &o->image_quality))
+               return EDJE_PICK_PARSE_FAILED;
+
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_IMAGE_COMPRESS,
+                    argc, argv, &i)))
+          {
+             if (!_edje_pick_uint_parse(EDJE_PICK_OPT_IMAGE_COMPRESS, v,
+                      0, 9, &o->image_compress))
+               return EDJE_PICK_PARSE_FAILED;
+
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_LOSSY_MIN,
+                    argc, argv, &i)))
+          {
+             if (!_edje_pick_uint_parse(EDJE_PICK_OPT_LOSSY_MIN, v,
+                      1, UINT_MAX, &o->lossy_min))
+               return EDJE_PICK_PARSE_FAILED;
+
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_MANIFEST, argc, argv, &i)))
+          {
+             if (!*v)
+               {
+                  EINA_LOG_ERR("Missing file name for %s\n",
+                        EDJE_PICK_OPT_MANIFEST);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             o->manifest = v;
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_STATS, argc, argv, &i)))
+          {
+             if (strcmp(v, "json"))
+               {
+                  EINA_LOG_ERR("Unsupported stats format '%s'\n", v);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             o->stats_json = EINA_TRUE;
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_TRACE_REPORT,
+                    argc, argv, &i)))
+          {
+             if (!*v)
+               {
+                  EINA_LOG_ERR("Missing file name for %s\n",
+                        EDJE_PICK_OPT_TRACE_REPORT);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             o->trace = v;
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_SCALES,
+                    argc, argv, &i)))
+          {
+#ifdef EDJE_PICK_HAVE_IMAGE_SETS
+             if (!_edje_pick_scales_parse(o, v))
+               return EDJE_PICK_PARSE_FAILED;
+
+             continue;
+#else
+             EINA_LOG_ERR("%s needs edje 1.18 or newer\n",
+                   EDJE_PICK_OPT_SCALES);
+             return EDJE_PICK_PARSE_FAILED;
+#endif
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_SPLIT_DEPTH,
+                    argc, argv, &i)))
+          {
+             if (!_edje_pick_uint_parse(EDJE_PICK_OPT_SPLIT_DEPTH, v,
+                      0, UINT_MAX, &o->split_depth))
+               return EDJE_PICK_PARSE_FAILED;
+
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_SPLIT, argc, argv, &i)))
+          {
+             if (!*v)
+               {
+                  EINA_LOG_ERR("Missing directory for %s\n",
+                        EDJE_PICK_OPT_SPLIT);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             o->split = v;
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_CACHE, argc, argv, &i)))
+          {
+             if (!*v)
+               {
+                  EINA_LOG_ERR("Missing directory for %s\n",
+                        EDJE_PICK_OPT_CACHE);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             o->cache = v;
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_DAEMON, argc, argv, &i)))
+          {
+             if (!*v)
+               {
+                  EINA_LOG_ERR("Missing socket name for %s\n",
+                        EDJE_PICK_OPT_DAEMON);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             o->daemon = v;
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_MAX_MEM, argc, argv, &i)))
+          {
+             if (!_edje_pick_size_parse(v, &o->max_mem) || (!o->max_mem))
+               {
+                  EINA_LOG_ERR("Invalid value '%s' for %s\n",
+                        v, EDJE_PICK_OPT_MAX_MEM);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_GROUP_REGEX,
+                    argc, argv, &i)))
+          {
+             if ((!*v) || (!input))
+               {
+                  EINA_LOG_ERR("%s needs a pattern and a -i input "
+                        "before it\n", EDJE_PICK_OPT_GROUP_REGEX);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             if (!_edje_pick_pattern_add(o, v, EINA_TRUE))
+               return EDJE_PICK_PARSE_FAILED;
+
+             continue;
+          }
+
+        if (!strcmp(argv[i], "-g") && ((i + 1) < argc) && input)
+          {  /* Exact names go through the set patterns fill, so a group
+                both named and matched is taken once */
+             Edje_Pick_Groups_From gf = { o, input };
+
+             if (strpbrk(argv[i + 1], "*?["))
+               _edje_pick_pattern_add(o, argv[++i], EINA_FALSE);
+             else
+               _edje_pick_groups_line(&gf, argv[++i]);
+
+             continue;
+          }
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_GROUPS_FROM,
+                    argc, argv, &i)))
+          {
+             Edje_Pick_Groups_From gf = { o, input };
+
+             if ((!*v) || (!input))
+               {
+                  EINA_LOG_ERR("%s needs a file name and a -i input "
+                        "before it\n", EDJE_PICK_OPT_GROUPS_FROM);
+                  return EDJE_PICK_PARSE_FAILED;
+               }
+
+             if (!strcmp(v, "-"))
+               {  /* Before reading it, the daemon's is nobody's input */
+                  if (o->served)
+                    {
+                       EINA_LOG_ERR("%s - is not allowed in a daemon "
+                             "request\n", EDJE_PICK_OPT_GROUPS_FROM);
+                       return EDJE_PICK_PARSE_FAILED;
+                    }
+
+                  if (o->groups_stdin)
+                    {
+                       EINA_LOG_ERR("stdin can be read only once\n");
+                       return EDJE_PICK_PARSE_FAILED;
+                    }
+
+                  o->groups_stdin = EINA_TRUE;
+               }
+
+             if (!_edje_pick_lines_read(v, _edje_pick_groups_line, &gf))
+               return EDJE_PICK_PARSE_FAILED;
+
+             continue;
+          }
+
+        if (_edje_pick_opt_value(EDJE_PICK_OPT_CONNECT, argc, argv, &i))
+          continue;  /* Daemon was not reachable, we run locally */
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_WATCH))
+          {
+             o->watch = EINA_TRUE;
+             continue;
+          }
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_REPRODUCIBLE))
+          {
+             o->reproducible = EINA_TRUE;
+             continue;
+          }
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_VERIFY))
+          {
+             o->verify = EINA_TRUE;
+             continue;
+          }
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_GC))
+          {
+             o->gc = EINA_TRUE;
+             continue;
+          }
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_OPAQUE))
+          {
+             o->opaque = EINA_TRUE;
+             continue;
+          }
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_RECOMPRESS))
+          {
+             o->recompress = EINA_TRUE;
+             continue;
+          }
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_DRY_RUN))
+          {
+             o->dry_run = EINA_TRUE;
+             continue;
+          }
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_DEDUP))
+          {
+             o->dedup = EINA_TRUE;
+             continue;
+          }
+
+        if (!strcmp(argv[i], EDJE_PICK_OPT_UP_TO_DATE))
+          {
+             o->up_to_date = EINA_TRUE;
+             continue;
+          }
+
+        if ((!strcmp(argv[i], "-i") || !strcmp(argv[i], "-a")) &&
+              ((i + 1) < argc))
+          {
+             s = _edje_pick_patterns_expand(o, input);
+             if (s != EDJE_PICK_NO_ERROR)
+               return s;
+
+             _edje_pick_input_add(o, argv[i + 1]);
+             input = strcmp(argv[i], "-i") ? NULL : argv[i + 1];
+          }
+        else if (!strcmp(argv[i], "-o") && ((i + 1) < argc))
+          o->output = argv[i + 1];
+
+        _edje_pick_arg_add(&o->argv, &o->argc, &o->argv_size, argv[i]);
+        if (_edje_pick_lib_opt_valued(argv[i]) && ((i + 1) < argc))
+          {  /* Taken as is, even a group named like a driver option */
+             i++;
+             _edje_pick_arg_add(&o->argv, &o->argc, &o->argv_size, argv[i]);
+          }
+     }
+
+   return _edje_pick_patterns_expand(o, input);
+}
+
+static void
+_edje_pick_opts_free(Edje_Pick_Opts *o)
+{
+   Edje_Pick_Pattern *pt;
+   const char *v;
+   unsigned int i;
+
+   _edje_pick_inputs_release(o);
+   for (i = 0; i < o->inputs_count; i++)
+     eina_stringshare_del(o->inputs[i].name);
+
+   free(o->inputs);
+   free(o->argv);
+   free(o->args);
+   eina_hash_free(o->listed);
+   EINA_LIST_FREE(o->strings, v)
+     eina_stringshare_del(v);
+
+   EINA_LIST_FREE(o->patterns, pt)
+     _edje_pick_pattern_free(pt);
+}
+
+static char *
+_edje_pick_cache_key(const Edje_Pick_Opts *o)
+{  /* Everything the output bytes depend on: arguments but the output
+      name, driver options changing the output, and input contents.
+      NULL if an input could not be hashed. */
+   Eina_Strbuf *buf;
+   unsigned int i;
+   int a;
+
+   for (i = 0; i < o->inputs_count; i++)
+     if (!o->inputs[i].hashed)
+       return NULL;
+
+   buf = eina_strbuf_new();
+   eina_strbuf_append(buf, EDJE_PICK_CACHE_VERSION "\n");
+   for (a = 1; a < o->argc; a++)
+     {
+        if ((!strcmp(o->argv[a], "-o")) && ((a + 1) < o->argc))
+          {
+             a++;
+             continue;
+          }
+
+        eina_strbuf_append_printf(buf, "arg %s\n", o->argv[a]);
+     }
+
+   eina_strbuf_append_printf(buf, "driver %d %d %u %u %u %d %d %d %d\n",
+         o->dedup, o->recompress, o->image_quality,
+         o->image_compress, o->lossy_min, o->reproducible, o->up_to_date,
+         o->gc, o->opaque);
+   for (i = 0; i < o->scales_count; i++)
+     eina_strbuf_append_printf(buf, "scale %g\n", o->scales[i]);
+
+   for (i = 0; i < o->inputs_count; i++)
+     eina_strbuf_append_printf(buf, "input %016llx %zu\n",
+           o->inputs[i].hash, o->inputs[i].size);
+
+   return eina_strbuf_string_steal(buf);
+}
+
+static Eina_Bool
+_edje_pick_file_copy(const char *src, const char *dst)
+{
+   Eina_Bool ret = EINA_FALSE;
+   Eina_File *f;
+   FILE *fp;
+   void *map;
+   size_t size;
+
+   f = eina_file_open(src, EINA_FALSE);
+   if (!f)
+     return EINA_FALSE;
+
+   size = eina_file_size_get(f);
+   map = eina_file_map_all(f, EINA_FILE_SEQUENTIAL);
+   fp = fopen(dst, "wb");
+   if (map && fp)
+     ret = (fwrite(map, 1, size, fp) == size);
+
+   if (fp && fclose(fp))
+     ret = EINA_FALSE;
+
+   if (map)
+     eina_file_map_free(f, map);
+
+   eina_file_close(f);
+   return ret;
+}
+
+static Eina_Bool
+_edje_pick_cache_file_put(const char *path, const char *src,
+      const char *data)
+{  /* Publish path atomically, from output src or from string data.
+      Cached files are read-only, outputs get copies of them. */
+   char tmp[PATH_MAX];
+   Eina_Bool ret;
+   Eet_File *ef;
+   FILE *fp;
+
+   snprintf(tmp, sizeof(tmp), "%s.%d", path, (int) getpid());
+   if (src)
+     {  /* The state entry names the output it was built as */
+        ret = _edje_pick_file_copy(src, tmp);
+        ef = ret ? eet_open(tmp, EET_FILE_MODE_READ_WRITE) : NULL;
+        if (ef)
+          {
+             eet_delete(ef, EDJE_PICK_STATE_ENTRY);
+             ret = (eet_close(ef) == EET_ERROR_NONE);
+          }
+        else
+          ret = EINA_FALSE;
+     }
+   else
+     {
+        fp = fopen(tmp, "wb");
+        ret = (fp && (fputs(data, fp) >= 0));
+        if (fp && fclose(fp))
+          ret = EINA_FALSE;
+     }
+
+   if (ret)
+     ret = ((chmod(tmp, 0444) == 0) && (rename(tmp, path) == 0));
+
+   if (!ret)
+     unlink(tmp);
+
+   return ret;
+}
+
+static Eina_Bool
+_edje_pick_cache_get(Edje_Pick_Opts *o, const char *key)
+{  /* Serve output from cache as a writable copy with its own state */
+   char path[PATH_MAX];
+   Eina_Bool found = EINA_FALSE;
+   Eina_File *f;
+   size_t len = strlen(key);
+
+   snprintf(path, sizeof(path), "%s/%016llx.key", o->cache,
+         _edje_pick_hash((const unsigned char *) key, len));
+   f = eina_file_open(path, EINA_FALSE);
+   if (f)
+     {  /* Full key check, the name is only a 64 bit hash of it */
+        void *map = eina_file_map_all(f, EINA_FILE_SEQUENTIAL);
+        found = (map && (eina_file_size_get(f) == len) &&
+              (!memcmp(map, key, len)));
+        if (map)
+          eina_file_map_free(f, map);
+
+        eina_file_close(f);
+     }
+
+   if (!found)
+     return EINA_FALSE;
+
+   strcpy(path + strlen(path) - strlen("key"), "edj");
+   unlink(o->output);  /* May be a link to it from older versions */
+   if (!_edje_pick_file_copy(path, o->output))
+     return EINA_FALSE;
+
+   if (o->state)
+     {
+        Eet_File *ef = eet_open(o->output, EET_FILE_MODE_READ_WRITE);
+        if (ef)
+          _edje_pick_output_close(o, ef);
+     }
+
+   return EINA_TRUE;
+}
+
+static void
+_edje_pick_cache_put(const Edje_Pick_Opts *o, const char *key)
+{
+   unsigned long long h;
+   char path[PATH_MAX];
+
+   if ((mkdir(o->cache, 0755) < 0) && (errno != EEXIST))
+     {
+        EINA_LOG_ERR("Failed to create cache directory '%s'\n", o->cache);
+        return;
+     }
+
+   h = _edje_pick_hash((const unsigned char *) key, strlen(key));
+   snprintf(path, sizeof(path), "%s/%016llx.edj", o->cache, h);
+   if (!_edje_pick_cache_file_put(path, o->output, NULL))
+     return;
+
+   /* Key goes last, an entry is only used once it is there */
+   snprintf(path, sizeof(path), "%s/%016llx.key", o->cache, h);
+   _edje_pick_cache_file_put(path, NULL, key);
+}
+
+static int
+_edje_pick_dry_run(const Edje_Pick_Opts *o)
+{  /* Check the selection in argv as edje_pick_process() would take it */
+   const Edje_Pick_Plan_Conflict *c;
+   const Eina_List *l;
+   Edje_Pick_Plan *p = edje_pick_plan_new();
+   const char *input = NULL;
+   const char *file;
+   int status;
+   int i;
+
+   if (o->gc)
+     edje_init();
+
+   for (i = 1; i < o->argc; i++)
+     {
+        if ((i + 1) >= o->argc)
+          break;
+
+        file = NULL;
+        if (!strcmp(o->argv[i], "-i"))
+          input = file = o->argv[++i];
+        else if (!strcmp(o->argv[i], "-a"))
+          edje_pick_plan_file_add(p, file = o->argv[++i]);
+        else if (!strcmp(o->argv[i], "-g") && input)
+          edje_pick_plan_group_add(p, input, o->argv[++i]);
+
+        if (o->gc && file)  /* Estimate with what the groups reach only */
+          edje_pick_plan_index_get(p, file);
+     }
+
+   EINA_LIST_FOREACH(edje_pick_plan_conflicts_get(p), l, c)
+     {
+        if (!c->group)
+          printf("%s: %s\n", c->file, edje_pick_err_str_get(c->status));
+        else if (c->other)
+          printf("%s: group '%s': %s (also in '%s')\n", c->file, c->group,
+                edje_pick_err_str_get(c->status), c->other);
+        else
+          printf("%s: group '%s': %s\n", c->file, c->group,
+                edje_pick_err_str_get(c->status));
+     }
+
+   status = edje_pick_plan_status_get(p);
+   printf("Dry run: %u conflicts, estimated output size %llu bytes\n",
+         eina_list_count(edje_pick_plan_conflicts_get(p)),
+         edje_pick_plan_size_estimate(p));
+
+   edje_pick_plan_free(p);
+   if (o->gc)
+     edje_shutdown();
+
+   return status;
+}
+
+int
+_edje_pick_run(Edje_Pick_Opts *o)
+{  /* Build one output, inputs are expected to be staged already */
+   Edje_Pick_Stats *st = o->stats;
+   char *key = NULL;
+   unsigned long long saved;
+   unsigned int count, pages, packed;
+   double t0;
+   int status;
+   int n;
+
+   if (o->dry_run)
+     return _edje_pick_dry_run(o);
+
+   if (o->up_to_date && o->output)
+     {
+        o->state = _edje_pick_state_make(o);
+        if (o->state && _edje_pick_state_up_to_date(o->output, o->state))
+          {
+             EINA_LOG_INFO("'%s' is up to date\n", o->output);
+             if (st)
+               st->skipped++;
+
+             free(o->state);
+             o->state = NULL;
+             return EDJE_PICK_NO_ERROR;
+          }
+     }
+
+   if (o->cache && o->output)
+     {
+        key = _edje_pick_cache_key(o);
+        if (key && _edje_pick_cache_get(o, key))
+          {
+             EINA_LOG_INFO("'%s' served from cache\n", o->output);
+             if (st)
+               {
+                  st->cache_hits++;
+                  _edje_pick_stats_output_add(st, o->output);
+               }
+
+             free(key);
+             free(o->state);
+             o->state = NULL;
+             return EDJE_PICK_NO_ERROR;
+          }
+     }
+
+   t0 = _edje_pick_time_get();
+   status = edje_pick_process(o->argc, o->argv);
+   _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_MERGE, t0);
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->gc && o->output)
+     {
+        t0 = _edje_pick_time_get();
+        saved = _edje_pick_gc(o, &count);
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_GC, t0);
+        if (st)
+          {
+             st->gc_removed += saved;
+             st->collected += count;
+          }
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->scales_count && o->output)
+     {  /* After gc, so dropped images get no variants */
+        t0 = _edje_pick_time_get();
+        count = _edje_pick_scale(o);
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_SCALE, t0);
+        if (st)
+          st->scaled += count;
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->opaque && o->output)
+     {  /* After scale, variants of opaque images are opaque too */
+        t0 = _edje_pick_time_get();
+        count = _edje_pick_opaque(o);
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_OPAQUE, t0);
+        if (st)
+          st->opaque += count;
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->recompress && o->output)
+     {
+        t0 = _edje_pick_time_get();
+        saved = _edje_pick_recompress(o, &count);
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_RECOMPRESS, t0);
+        if (st)
+          {
+             st->recompress_saved += saved;
+             st->recompressed += count;
+          }
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->dedup && o->output)
+     {
+        t0 = _edje_pick_time_get();
+        saved = _edje_pick_dedup(o);
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_DEDUP, t0);
+        if (st)
+          st->dedup_saved += saved;
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->reproducible && o->output)
+     {
+        t0 = _edje_pick_time_get();
+        if (!_edje_pick_canonical(o))
+          status = EDJE_PICK_FAILED_CLOSE_OUT;
+
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_CANONICAL, t0);
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->state)
+     {  /* No pass wrote the output, the merge alone built it */
+        Eet_File *ef;
+
+        t0 = _edje_pick_time_get();
+        ef = eet_open(o->output, EET_FILE_MODE_READ_WRITE);
+        if (ef)
+          _edje_pick_output_close(o, ef);
+
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_STATE, t0);
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->trace && o->output)
+     {  /* After the canonical rewrite, which moves entries */
+        t0 = _edje_pick_time_get();
+        _edje_pick_trace(o, &pages, &packed);
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_TRACE, t0);
+        if (st)
+          {
+             st->trace_pages += pages;
+             st->trace_pages_packed += packed;
+          }
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && o->verify && o->output)
+     {  /* On the final output, and before a broken one gets cached */
+        t0 = _edje_pick_time_get();
+        n = _edje_pick_verify(o, &count);
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_VERIFY, t0);
+        if (st)
+          {
+             st->verified += count;
+             st->problems += n;
+          }
+
+        if (n)
+          status = EDJE_PICK_FAILED_CLOSE_OUT;
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && key)
+     {
+        t0 = _edje_pick_time_get();
+        _edje_pick_cache_put(o, key);
+        _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_CACHE, t0);
+        if (st)
+          st->cache_misses++;
+     }
+   if (st && (status == EDJE_PICK_NO_ERROR) && o->output)
+     _edje_pick_stats_output_add(st, o->output);
+
+   free(key);
+   free(o->state);
+   o->state = NULL;
+   return status;
+}
+
+static void
+_edje_pick_spec_free(Edje_Pick_Spec *sp)
+{
+   _edje_pick_opts_free(&sp->opts);
+   free(sp->argv);
+   free(sp->line);
+   free(sp);
+}
+
+static Edje_Pick_Spec *
+_edje_pick_spec_new(char *line, unsigned int lineno, const char *prog)
+{  /* Split a manifest line to argv, NULL for blank and comment lines */
+   Edje_Pick_Spec *sp;
+   char *save = NULL;
+   char *tok;
+   int max = 2;
+
+   tok = line + strspn(line, " \t\r\n");
+   if ((!*tok) || (*tok == '#'))
+     return NULL;
+
+   for (tok = line; *tok; tok++)
+     if ((*tok == ' ') || (*tok == '\t'))
+       max++;
+
+   sp = calloc(1, sizeof(Edje_Pick_Spec));
+   sp->line = strdup(line);
+   sp->lineno = lineno;
+   sp->argv = calloc(max + 1, sizeof(char *));
+   sp->argv[sp->argc++] = (char *) prog;
+   for (tok = strtok_r(sp->line, " \t\r\n", &save); tok;
+         tok = strtok_r(NULL, " \t\r\n", &save))
+     sp->argv[sp->argc++] = tok;
+
+   return sp;
+}
+
+static Eina_List *
+_edje_pick_manifest_read(const char *file, const char *prog)
+{
+   Eina_List *specs = NULL;
+   Edje_Pick_Spec *sp;
+   unsigned int lineno = 0;
+   char *line = NULL;
+   size_t len = 0;
+   FILE *fp;
+
+   fp = fopen(file, "r");
+   if (!fp)
+     {
+        EINA_LOG_ERR("Failed to open manifest '%s'\n", file);
+        return NULL;
+     }
+
+   while (getline(&line, &len, fp) >= 0)
+     {
+        sp = _edje_pick_spec_new(line, ++lineno, prog);
+        if (sp)
+          specs = eina_list_append(specs, sp);
+     }
+
+   free(line);
+   fclose(fp);
+   if (!specs)
+     EINA_LOG_ERR("Manifest '%s' lists no output\n", file);
+
+   return specs;
+}
+
+static Edje_Pick_Status
+_edje_pick_spec_check(const Edje_Pick_Opts *o)
+{  /* What edje_pick_process() would reject in the arguments left for it,
+      so a bad spec is found before any output is built */
+   int i;
+
+   if (!o->output)
+     return EDJE_PICK_OUT_FILENAME_MISSING;
+
+   if (!o->inputs_count)
+     return EDJE_PICK_INCLUDE_MISSING;
+
+   for (i = 1; i < o->argc; i++)
+     {
+        if (_edje_pick_lib_opt_valued(o->argv[i]) && ((i + 1) < o->argc))
+          i++;
+        else if (strcmp(o->argv[i], "-v") && strcmp(o->argv[i], "--verbose"))
+          {
+             EINA_LOG_ERR("Unexpected argument '%s'\n", o->argv[i]);
+             return EDJE_PICK_PARSE_FAILED;
+          }
+     }
+
+   return EDJE_PICK_NO_ERROR;
+}
+
+static Eina_Bool
+_edje_pick_specs_hashing(const Eina_List *specs)
+{  /* Inputs must be hashed when any spec needs their contents */
+   const Eina_List *l;
+   Edje_Pick_Spec *sp;
+
+   EINA_LIST_FOREACH(specs, l, sp)
+     if (_edje_pick_opts_hashing(&sp->opts))
+       return EINA_TRUE;
+
+   return EINA_FALSE;
+}
+
+static int
+_edje_pick_manifest_run(Edje_Pick_Opts *o, const char *prog)
+{  /* Build every output of the manifest in this process. The union of
+      all inputs is staged once, and eet keeps opened inputs (with their
+      parsed directories) cached between outputs. */
+   Eina_List *specs, *l;
+   Edje_Pick_Spec *sp;
+   unsigned int i;
+   int status = EDJE_PICK_NO_ERROR;
+   int s;
+
+   specs = _edje_pick_manifest_read(o->manifest, prog);
+   if (!specs)
+     return EDJE_PICK_PARSE_FAILED;
+
+   EINA_LIST_FOREACH(specs, l, sp)
+     {  /* Parse all specs first, don't build anything on error */
+        s = _edje_pick_opts_parse(&sp->opts, sp->argc, sp->argv, o);
+        if ((s == EDJE_PICK_NO_ERROR) && (sp->opts.manifest || sp->opts.split))
+          s = EDJE_PICK_PARSE_FAILED;  /* No nested manifests or splits */
+
+        if (s == EDJE_PICK_NO_ERROR)
+          s = _edje_pick_spec_check(&sp->opts);
+
+        if (s != EDJE_PICK_NO_ERROR)
+          {
+             EINA_LOG_ERR("%s:%u: invalid output spec: %s\n",
+                   o->manifest, sp->lineno, edje_pick_err_str_get(s));
+             status = s;
+             goto end;
+          }
+
+        for (i = 0; i < sp->opts.inputs_count; i++)
+          _edje_pick_input_add(o, sp->opts.inputs[i].name);
+     }
+
+   if (_edje_pick_specs_hashing(specs))
+     o->up_to_date = EINA_TRUE;  /* Only used for staging here */
+
+   if (!o->dry_run)
+     _edje_pick_inputs_stage(o);
+
+   if (!o->budget)  /* Otherwise inputs are closed between outputs */
+     eet_cacheburst(EINA_TRUE);
+   EINA_LIST_FOREACH(specs, l, sp)
+     {
+        _edje_pick_inputs_share(o, &sp->opts);
+        s = _edje_pick_run(&sp->opts);
+        if (s != EDJE_PICK_NO_ERROR)
+          {  /* Report and go on with the other outputs */
+             EINA_LOG_ERR("%s:%u: %s\n", o->manifest, sp->lineno,
+                   edje_pick_err_str_get(s));
+             if (status == EDJE_PICK_NO_ERROR)
+               status = s;
+          }
+     }
+
+   if (!o->budget)
+     eet_cacheburst(EINA_FALSE);
+
+   if (o->watch && (!o->dry_run))
+     {  /* Specs own their opts, watch them in place */
+        Eina_List *targets = NULL;
+
+        EINA_LIST_FOREACH(specs, l, sp)
+          targets = eina_list_append(targets, &sp->opts);
+
+        s = _edje_pick_watch(targets);
+        if (status == EDJE_PICK_NO_ERROR)
+          status = s;
+
+        eina_list_free(targets);
+     }
+
+end:
+   EINA_LIST_FREE(specs, sp)
+     _edje_pick_spec_free(sp);
+
+   return status;
+}
+
+int
+_edje_pick_exec(int argc, char **argv, Eina_Bool served)
+{  /* One edje_pick invocation, from main() or from a daemon request */
+   Edje_Pick_Budget budget;
+   Edje_Pick_Stats stats;
+   Edje_Pick_Opts opts;
+   int status;
+
+   memset(&stats, 0, sizeof(stats));
+   stats.start = _edje_pick_time_get();
+   opts.served = served;
+   status = _edje_pick_opts_parse(&opts, argc, argv, NULL);
+   _edje_pick_stats_phase_add(&stats, EDJE_PICK_PHASE_PARSE, stats.start);
+   if (opts.stats_json)
+     opts.stats = &stats;
+
+   if (opts.max_mem)
+     {
+        _edje_pick_budget_init(&budget, opts.max_mem);
+        opts.budget = &budget;
+     }
+
+   if ((status == EDJE_PICK_NO_ERROR) && served &&
+         (opts.daemon || opts.watch))
+     {  /* Would keep the daemon from serving anyone else */
+        EINA_LOG_ERR("%s is not allowed in a daemon request\n",
+              opts.daemon ? EDJE_PICK_OPT_DAEMON : EDJE_PICK_OPT_WATCH);
+        status = EDJE_PICK_PARSE_FAILED;
+     }
+
+   if (status == EDJE_PICK_NO_ERROR)
+     {  /* Inputs are prefetched in parallel, edje_pick_process() merges
+           them on this thread */
+        if (opts.daemon)
+          status = _edje_pick_daemon_run(opts.daemon, argv[0]);
+        else if (opts.manifest)
+          status = _edje_pick_manifest_run(&opts, argv[0]);
+        else if (opts.split)
+          {
+             if (!opts.dry_run)
+               _edje_pick_inputs_stage(&opts);
+
+             status = _edje_pick_split(&opts);
+          }
+        else
+          {
+             if (!opts.dry_run)  /* Inputs are not read as a whole */
+               _edje_pick_inputs_stage(&opts);
+
+             status = _edje_pick_run(&opts);
+             if ((status != EDJE_PICK_HELP_SHOWN) && opts.watch &&
+                   (!opts.dry_run))
+               {  /* Go on watching after a failed build, it is fixed
+                     by rewriting an input */
+                  Eina_List *targets = eina_list_append(NULL, &opts);
+                  _edje_pick_watch(targets);
+                  eina_list_free(targets);
+               }
+          }
+
+        if (status == EDJE_PICK_HELP_SHOWN)
+          printf("\n%s", EDJE_PICK_DRIVER_USAGE);
+     }
+
+   if (opts.stats)
+     _edje_pick_stats_print(opts.stats, status);
+
+   _edje_pick_opts_free(&opts);
+   if (opts.budget)
+     _edje_pick_budget_shutdown(opts.budget);
+   return status;
+}
 
 int
 main(int argc, char **argv)
 {
-   Edje_Pick *context = edje_pick_context_new();
-   edje_pick_context_set(context);
+   const char *server = _edje_pick_client_server_get(argc, argv);
+   Edje_Pick *context;
    int status;
 
+   if (server)
+     {  /* Thin client, no edje_pick startup cost */
+        status = _edje_pick_client_run(server, argc, argv);
+        if (status >= 0)
+          return status;
+     }
+
+   context = edje_pick_context_new();
+   edje_pick_context_set(context);
+
    edje_pick_init();
    eina_log_level_set(EINA_LOG_LEVEL_WARN);  /* Changed to INFO if verbose */
 
-   status = edje_pick_process(argc, argv);
+   status = _edje_pick_exec(argc, argv, EINA_FALSE);
 
    edje_pick_context_free(context);
    edje_pick_shutdown();
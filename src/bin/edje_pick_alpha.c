@@ -0,0 +1,35 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "edje_pick_alpha.h"
+
+/* Pixels ANDed between checks, a few vector registers worth */
+#define EDJE_PICK_ALPHA_BLOCK 64
+
+int
+edje_pick_alpha_opaque(const unsigned int *pixels, size_t count)
+{  /* The inner loop has a constant trip count so it is vectorized at
+      -O2 too, where GCC 12 doesn't version loops of unknown length */
+   const unsigned int *p = pixels;
+   const unsigned int *full;
+   unsigned int acc;
+   unsigned int k;
+
+   full = pixels + (count - (count % EDJE_PICK_ALPHA_BLOCK));
+   for (; p < full; p += EDJE_PICK_ALPHA_BLOCK)
+     {
+        acc = 0xffffffff;
+        for (k = 0; k < EDJE_PICK_ALPHA_BLOCK; k++)
+          acc &= p[k];
+
+        if ((acc >> 24) != 0xff)
+          return 0;
+     }
+
+   acc = 0xffffffff;  /* Tail, less than a block */
+   for (; p < pixels + count; p++)
+     acc &= *p;
+
+   return ((acc >> 24) == 0xff);
+}
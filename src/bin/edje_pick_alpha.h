@@ -0,0 +1,14 @@
+#ifndef EDJE_PICK_ALPHA_H
+#define EDJE_PICK_ALPHA_H
+
+#include <stddef.h>
+
+/* Opacity scan of ARGB32 pixels. Blocks of pixels are ANDed together
+   with no branches, so compilers vectorize the loop, and the alpha of
+   the result is checked once per block to stop at the first
+   translucent one. */
+
+/* 1 if every one of the count pixels has alpha 0xff */
+int edje_pick_alpha_opaque(const unsigned int *pixels, size_t count);
+
+#endif
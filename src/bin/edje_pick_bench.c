@@ -0,0 +1,410 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <Eina.h>
+
+#include "Edje_Pick.h"
+
+/* Synthetic .edj generator and merge benchmark, run with 'make bench'.
+   Each scale runs in its own process so peak RSS is per scale.
+   Output lines are "key=value" pairs, stable for diffing between commits. */
+
+#define BENCH_FORMAT_VERSION 1
+#define BENCH_DEFAULT_DIR "bench_data"
+#define BENCH_INPUTS 2              /* Inputs merged per scale */
+#define BENCH_MAX_FONTS 8
+
+static const unsigned int _bench_image_sizes[] = { 16, 64, 256 };
+
+typedef struct _Bench_Opts Bench_Opts;
+struct _Bench_Opts
+{
+   const char *dir;       /* Where inputs are generated and kept */
+   const char *edje_cc;   /* Compiler used to build inputs */
+   const char *font;      /* Optional TTF embedded under several names */
+};
+
+typedef struct _Bench_Counts Bench_Counts;
+struct _Bench_Counts
+{  /* Items in one generated input */
+   unsigned int groups;
+   unsigned int images;
+   unsigned int samples;
+   unsigned int fonts;
+};
+
+static double
+_bench_time_get(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec + (t.tv_nsec / 1000000000.0);
+}
+
+static long
+_bench_peak_rss_kb(void)
+{
+   struct rusage ru;
+
+   if (getrusage(RUSAGE_SELF, &ru) < 0)
+     return -1;
+
+   return ru.ru_maxrss;
+}
+
+static unsigned long long
+_bench_file_size(const char *path)
+{
+   struct stat st;
+
+   if (stat(path, &st) < 0)
+     return 0;
+
+   return st.st_size;
+}
+
+static Eina_Bool
+_bench_image_write(const char *path, unsigned int size, unsigned int seed)
+{  /* Binary PPM, content differs per seed so nothing dedups by accident */
+   unsigned int x, y;
+   FILE *fp = fopen(path, "wb");
+
+   if (!fp)
+     return EINA_FALSE;
+
+   fprintf(fp, "P6\n%u %u\n255\n", size, size);
+   for (y = 0; y < size; y++)
+     for (x = 0; x < size; x++)
+       {
+          fputc((x * 7 + seed) & 0xff, fp);
+          fputc((y * 5 + (seed >> 8)) & 0xff, fp);
+          fputc((x ^ y ^ seed) & 0xff, fp);
+       }
+
+   fclose(fp);
+   return EINA_TRUE;
+}
+
+static void
+_bench_le_write(FILE *fp, unsigned int v, unsigned int bytes)
+{
+   unsigned int i;
+
+   for (i = 0; i < bytes; i++)
+     fputc((v >> (i * 8)) & 0xff, fp);
+}
+
+static Eina_Bool
+_bench_sample_write(const char *path, unsigned int seed)
+{  /* 0.1s of 8kHz mono 16-bit PCM */
+   unsigned int frames = 800;
+   unsigned int i;
+   FILE *fp = fopen(path, "wb");
+
+   if (!fp)
+     return EINA_FALSE;
+
+   fwrite("RIFF", 1, 4, fp);
+   _bench_le_write(fp, 36 + (frames * 2), 4);
+   fwrite("WAVEfmt ", 1, 8, fp);
+   _bench_le_write(fp, 16, 4);    /* fmt chunk size */
+   _bench_le_write(fp, 1, 2);     /* PCM */
+   _bench_le_write(fp, 1, 2);     /* Channels */
+   _bench_le_write(fp, 8000, 4);  /* Rate */
+   _bench_le_write(fp, 16000, 4); /* Byte rate */
+   _bench_le_write(fp, 2, 2);     /* Block align */
+   _bench_le_write(fp, 16, 2);    /* Bits */
+   fwrite("data", 1, 4, fp);
+   _bench_le_write(fp, frames * 2, 4);
+   for (i = 0; i < frames; i++)
+     _bench_le_write(fp, ((i * (seed + 1)) & 0x7fff), 2);
+
+   fclose(fp);
+   return EINA_TRUE;
+}
+
+static void
+_bench_counts_get(Bench_Counts *c, unsigned int scale, Eina_Bool font)
+{  /* Split 'scale' items per resource type over the inputs */
+   c->groups = (scale + BENCH_INPUTS - 1) / BENCH_INPUTS;
+   c->images = c->groups;
+   c->samples = (c->groups / 10) + 1;
+   c->fonts = font ? ((c->groups / 100) + 1) : 0;
+   if (c->fonts > BENCH_MAX_FONTS)
+     c->fonts = BENCH_MAX_FONTS;
+}
+
+static Eina_Bool
+_bench_edc_write(const char *path, const Bench_Counts *c,
+      unsigned int input, Eina_Bool font)
+{  /* Each group shows one image and plays one sample on show */
+   unsigned int i;
+   FILE *fp = fopen(path, "w");
+
+   if (!fp)
+     return EINA_FALSE;
+
+   fprintf(fp, "images {\n");
+   for (i = 0; i < c->images; i++)
+     fprintf(fp, "   image: \"i%u_%u.ppm\" COMP;\n", input, i);
+
+   fprintf(fp, "}\nsounds {\n");
+   for (i = 0; i < c->samples; i++)
+     fprintf(fp, "   sample { name: \"s%u_%u\" AS_IS; "
+           "source: \"s%u_%u.wav\"; }\n", input, i, input, i);
+
+   fprintf(fp, "}\n");
+   if (font)
+     {
+        fprintf(fp, "fonts {\n");
+        for (i = 0; i < c->fonts; i++)
+          fprintf(fp, "   font: \"bench.ttf\" \"Bench%u_%u\";\n", input, i);
+
+        fprintf(fp, "}\n");
+     }
+
+   fprintf(fp, "collections {\n");
+   for (i = 0; i < c->groups; i++)
+     {
+        fprintf(fp, "   group { name: \"bench/%u/%u\";\n", input, i);
+        fprintf(fp, "      parts { part { name: \"img\"; type: IMAGE;\n");
+        fprintf(fp, "         description { state: \"default\" 0.0;\n");
+        fprintf(fp, "            image.normal: \"i%u_%u.ppm\"; } } }\n",
+              input, i % c->images);
+        fprintf(fp, "      programs { program { name: \"snd\"; "
+              "signal: \"show\"; action: PLAY_SAMPLE \"s%u_%u\" 1.0; } }\n",
+              input, i % c->samples);
+        fprintf(fp, "   }\n");
+     }
+
+   fprintf(fp, "}\n");
+   fclose(fp);
+   return EINA_TRUE;
+}
+
+static Eina_Bool
+_bench_input_make(const Bench_Opts *o, unsigned int scale,
+      unsigned int input, const char *edj)
+{  /* Generate sources for one input and compile them with edje_cc */
+   Bench_Counts c;
+   char path[PATH_MAX];
+   char cmd[PATH_MAX * 4];
+   unsigned int i;
+   int ret;
+
+   _bench_counts_get(&c, scale, (o->font != NULL));
+   for (i = 0; i < c.images; i++)
+     {
+        snprintf(path, sizeof(path), "%s/i%u_%u.ppm", o->dir, input, i);
+        if (!_bench_image_write(path, _bench_image_sizes[i %
+                 EINA_C_ARRAY_LENGTH(_bench_image_sizes)], i + input * 65536))
+          return EINA_FALSE;
+     }
+
+   for (i = 0; i < c.samples; i++)
+     {
+        snprintf(path, sizeof(path), "%s/s%u_%u.wav", o->dir, input, i);
+        if (!_bench_sample_write(path, i + input * 65536))
+          return EINA_FALSE;
+     }
+
+   if (o->font)
+     {  /* edje_cc looks fonts up in the font dir */
+        snprintf(cmd, sizeof(cmd), "cp '%s' '%s/bench.ttf'", o->font, o->dir);
+        if (system(cmd))
+          return EINA_FALSE;
+     }
+
+   snprintf(path, sizeof(path), "%s/in_%u_%u.edc", o->dir, scale, input);
+   if (!_bench_edc_write(path, &c, input, (o->font != NULL)))
+     return EINA_FALSE;
+
+   snprintf(cmd, sizeof(cmd),
+         "'%s' -id '%s' -sd '%s' -fd '%s' '%s' '%s' > /dev/null",
+         o->edje_cc, o->dir, o->dir, o->dir, path, edj);
+   ret = system(cmd);
+   if (ret)
+     fprintf(stderr, "edje_pick_bench: '%s' failed (%d)\n", cmd, ret);
+
+   return (ret == 0);
+}
+
+static void
+_bench_report(unsigned int scale, const char *op, unsigned int items,
+      unsigned long long bytes, double secs)
+{
+   if (secs <= 0.0)
+     secs = 1e-9;
+
+   printf("edje_pick_bench v%d scale=%u op=%s items=%u bytes=%llu "
+         "seconds=%.6f items_per_s=%.1f mb_per_s=%.3f peak_rss_kb=%ld\n",
+         BENCH_FORMAT_VERSION, scale, op, items, bytes, secs,
+         items / secs, (bytes / (1024.0 * 1024.0)) / secs,
+         _bench_peak_rss_kb());
+   fflush(stdout);
+}
+
+static int
+_bench_scale_run(const Bench_Opts *o, unsigned int scale)
+{  /* Runs in a child process, see main() */
+   char edj[BENCH_INPUTS][PATH_MAX];
+   char out[PATH_MAX];
+   char *argv[3 + (BENCH_INPUTS * 2)];
+   unsigned long long bytes = 0;
+   unsigned int items = 0;
+   Bench_Counts c;
+   Edje_Pick *context;
+   double t0;
+   int argc = 0;
+   int status;
+   int i;
+
+   _bench_counts_get(&c, scale, (o->font != NULL));
+   for (i = 0; i < BENCH_INPUTS; i++)
+     {  /* Inputs are kept in dir and reused by later runs */
+        snprintf(edj[i], sizeof(edj[i]), "%s/in_%u_%d.edj", o->dir, scale, i);
+        if ((!_bench_file_size(edj[i])) &&
+              (!_bench_input_make(o, scale, i, edj[i])))
+          return 1;
+
+        bytes += _bench_file_size(edj[i]);
+        items += c.groups + c.images + c.samples + c.fonts;
+     }
+
+   context = edje_pick_context_new();
+   edje_pick_context_set(context);
+   edje_pick_init();
+   eina_log_level_set(EINA_LOG_LEVEL_ERR);
+
+   t0 = _bench_time_get();
+   for (i = 0; i < BENCH_INPUTS; i++)
+     {
+        Eina_List *grp = NULL, *img = NULL, *smp = NULL, *fnt = NULL;
+        void *ex;
+
+        edje_pick_file_info_read(edj[i], &grp, &img, &smp, &fnt);
+        eina_list_free(grp);
+        EINA_LIST_FREE(img, ex)
+          free(ex);
+
+        EINA_LIST_FREE(smp, ex)
+          free(ex);
+
+        EINA_LIST_FREE(fnt, ex)
+          free(ex);
+     }
+   _bench_report(scale, "scan", items, bytes, _bench_time_get() - t0);
+
+   snprintf(out, sizeof(out), "%s/out_%u.edj", o->dir, scale);
+   argv[argc++] = "edje_pick_bench";
+   argv[argc++] = "-o";
+   argv[argc++] = out;
+   for (i = 0; i < BENCH_INPUTS; i++)
+     {
+        argv[argc++] = "-a";
+        argv[argc++] = edj[i];
+     }
+
+   t0 = _bench_time_get();
+   status = edje_pick_process(argc, argv);
+   if (status == EDJE_PICK_NO_ERROR)
+     _bench_report(scale, "merge", items, bytes, _bench_time_get() - t0);
+   else
+     fprintf(stderr, "edje_pick_bench: merge failed: %s\n",
+           edje_pick_err_str_get(status));
+
+   unlink(out);
+   edje_pick_context_free(context);
+   edje_pick_shutdown();
+   return (status != EDJE_PICK_NO_ERROR);
+}
+
+static void
+_bench_usage(const char *prog)
+{
+   fprintf(stderr,
+         "Usage: %s [-d DIR] [-c EDJE_CC] [-f FONT.ttf] SCALE...\n"
+         "  Generates BENCH inputs under DIR (default '%s') with SCALE\n"
+         "  groups and images in total, then times scan and merge.\n",
+         prog, BENCH_DEFAULT_DIR);
+}
+
+int
+main(int argc, char **argv)
+{
+   Bench_Opts o;
+   int failed = 0;
+   int i;
+
+   o.dir = BENCH_DEFAULT_DIR;
+   o.edje_cc = getenv("EDJE_CC") ? getenv("EDJE_CC") : "edje_cc";
+   o.font = NULL;
+
+   for (i = 1; (i < argc) && (argv[i][0] == '-'); i++)
+     {
+        if (!argv[i][1] || argv[i][2] || ((i + 1) >= argc))
+          {
+             _bench_usage(argv[0]);
+             return 1;
+          }
+
+        switch (argv[i][1])
+          {
+           case 'd':
+              o.dir = argv[++i];
+              break;
+
+           case 'c':
+              o.edje_cc = argv[++i];
+              break;
+
+           case 'f':
+              o.font = argv[++i];
+              break;
+
+           default:
+              _bench_usage(argv[0]);
+              return 1;
+          }
+     }
+
+   if (i >= argc)
+     {
+        _bench_usage(argv[0]);
+        return 1;
+     }
+
+   mkdir(o.dir, 0755);
+   for (; i < argc; i++)
+     {  /* One process per scale, so ru_maxrss is not carried over */
+        unsigned int scale = strtoul(argv[i], NULL, 10);
+        int status = 1;
+        pid_t pid;
+
+        if (!scale)
+          continue;
+
+        pid = fork();
+        if (pid == 0)
+          _exit(_bench_scale_run(&o, scale));
+
+        if ((pid < 0) || (waitpid(pid, &status, 0) < 0) ||
+              (!WIFEXITED(status)) || WEXITSTATUS(status))
+          failed++;
+     }
+
+   return (failed != 0);
+}
@@ -0,0 +1,269 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <Eina.h>
+#include <Eet.h>
+#include <Ecore.h>
+#include <Ecore_Ipc.h>
+
+#include "Edje_Pick.h"
+#include "edje_pick_private.h"
+
+/* --daemon, serving edje_pick runs on a local socket, and the client
+   forwarding its command line there */
+
+/* IPC between client and daemon, see _edje_pick_client_run() */
+#define EDJE_PICK_IPC_MAJOR  0xed7e
+#define EDJE_PICK_IPC_RUN    1  /* data: cwd, then args, '\0' separated */
+#define EDJE_PICK_IPC_STATUS 2  /* response: exit status of the run,
+                                   data: what it printed on stdout */
+
+static int
+_edje_pick_daemon_request(const char *prog, const char *data, int size)
+{  /* Run a forwarded command line: cwd, then args, all '\0' terminated */
+   const char *p, *end = data + size;
+   char **argv;
+   int argc = 1;
+   int status;
+
+   if ((size <= 0) || (data[size - 1] != '\0'))
+     return EDJE_PICK_PARSE_FAILED;
+
+   if (chdir(data) < 0)
+     {
+        EINA_LOG_ERR("Failed to enter client directory '%s'\n", data);
+        return EDJE_PICK_PARSE_FAILED;
+     }
+
+   for (p = data + strlen(data) + 1; p < end; p += strlen(p) + 1)
+     argc++;
+
+   argv = calloc(argc + 1, sizeof(char *));
+   argv[0] = (char *) prog;
+   argc = 1;
+   for (p = data + strlen(data) + 1; p < end; p += strlen(p) + 1)
+     argv[argc++] = (char *) p;
+
+   /* Previous request may have raised it with -v */
+   eina_log_level_set(EINA_LOG_LEVEL_WARN);
+   status = _edje_pick_exec(argc, argv, EINA_TRUE);
+   free(argv);
+   return status;
+}
+
+static char *
+_edje_pick_daemon_output_end(FILE *fp, int saved, int *size)
+{  /* Put stdout back and return what the request printed, *size bytes */
+   char *out = NULL;
+   off_t len;
+
+   *size = 0;
+   fflush(stdout);
+   dup2(saved, STDOUT_FILENO);
+   close(saved);
+   len = lseek(fileno(fp), 0, SEEK_CUR);
+   if ((len <= 0) || (len > INT_MAX))
+     return NULL;
+
+   out = malloc(len);
+   rewind(fp);
+   if (out && (fread(out, 1, len, fp) == (size_t) len))
+     *size = len;
+
+   return out;
+}
+
+static Eina_Bool
+_edje_pick_daemon_data(void *data, int type EINA_UNUSED, void *event)
+{  /* Run a request with stdout in a temporary file, which goes back to
+      the client with the status, as stats and reports are printed */
+   Ecore_Ipc_Event_Client_Data *e = event;
+   char *out = NULL;
+   FILE *fp;
+   int saved = -1;
+   int status, size = 0;
+
+   if ((e->major != EDJE_PICK_IPC_MAJOR) || (e->minor != EDJE_PICK_IPC_RUN))
+     return ECORE_CALLBACK_PASS_ON;
+
+   fflush(stdout);
+   fp = tmpfile();
+   if (fp)
+     saved = dup(STDOUT_FILENO);
+
+   if ((saved >= 0) && (dup2(fileno(fp), STDOUT_FILENO) < 0))
+     {
+        close(saved);
+        saved = -1;
+     }
+
+   status = _edje_pick_daemon_request(data, e->data, e->size);
+   if (saved >= 0)
+     out = _edje_pick_daemon_output_end(fp, saved, &size);
+
+   if (fp)
+     fclose(fp);
+
+   ecore_ipc_client_send(e->client, EDJE_PICK_IPC_MAJOR,
+         EDJE_PICK_IPC_STATUS, e->ref, 0, status, out, size);
+   ecore_ipc_client_flush(e->client);
+   free(out);
+   return ECORE_CALLBACK_DONE;
+}
+
+int
+_edje_pick_daemon_run(const char *name, const char *prog)
+{  /* Serve requests one at a time, until terminated. The edje_pick
+      context stays initialized, and eet keeps inputs opened by earlier
+      requests cached along with their parsed directories. */
+   Ecore_Event_Handler *h;
+   Ecore_Ipc_Server *srv;
+
+   ecore_init();
+   ecore_ipc_init();
+   srv = ecore_ipc_server_add(ECORE_IPC_LOCAL_USER, name, 0, NULL);
+   if (!srv)
+     {
+        EINA_LOG_ERR("Failed to listen on '%s'\n", name);
+        ecore_ipc_shutdown();
+        ecore_shutdown();
+        return EDJE_PICK_PARSE_FAILED;
+     }
+
+   h = ecore_event_handler_add(ECORE_IPC_EVENT_CLIENT_DATA,
+         _edje_pick_daemon_data, prog);
+
+   eet_cacheburst(EINA_TRUE);
+   ecore_main_loop_begin();
+   eet_cacheburst(EINA_FALSE);
+
+   ecore_event_handler_del(h);
+   ecore_ipc_server_del(srv);
+   ecore_ipc_shutdown();
+   ecore_shutdown();
+   return EDJE_PICK_NO_ERROR;
+}
+
+static Eina_Bool
+_edje_pick_client_data(void *data, int type EINA_UNUSED, void *event)
+{
+   Ecore_Ipc_Event_Server_Data *e = event;
+   int *status = data;
+
+   if ((e->major != EDJE_PICK_IPC_MAJOR) ||
+         (e->minor != EDJE_PICK_IPC_STATUS))
+     return ECORE_CALLBACK_PASS_ON;
+
+   if (e->size > 0)  /* What the run printed on the daemon side */
+     {
+        fwrite(e->data, 1, e->size, stdout);
+        fflush(stdout);
+     }
+
+   *status = e->response;
+   ecore_main_loop_quit();
+   return ECORE_CALLBACK_DONE;
+}
+
+static Eina_Bool
+_edje_pick_client_del(void *data EINA_UNUSED, int type EINA_UNUSED,
+      void *event EINA_UNUSED)
+{  /* Daemon went away before answering */
+   ecore_main_loop_quit();
+   return ECORE_CALLBACK_DONE;
+}
+
+const char *
+_edje_pick_client_server_get(int argc, char **argv)
+{  /* Daemon to forward to, NULL to run here */
+   const char *server = getenv(EDJE_PICK_DAEMON_ENV);
+   const char *v;
+   int i;
+
+   for (i = 1; i < argc; i++)
+     {
+        if (_edje_pick_lib_opt_valued(argv[i]))
+          {  /* Its value is never a driver option */
+             i++;
+             continue;
+          }
+
+        if (_edje_pick_opt_value(EDJE_PICK_OPT_DAEMON, argc, argv, &i))
+          return NULL;  /* We are the daemon */
+
+        if ((v = _edje_pick_opt_value(EDJE_PICK_OPT_CONNECT, argc, argv, &i)))
+          server = v;
+     }
+
+   return (server && *server) ? server : NULL;
+}
+
+int
+_edje_pick_client_run(const char *server, int argc, char **argv)
+{  /* Forward argv (without --connect) and cwd to the daemon, returns
+      its status or -1 when the daemon could not be reached */
+   Ecore_Event_Handler *hd, *hx;
+   Ecore_Ipc_Server *srv;
+   Eina_Binbuf *buf;
+   char cwd[PATH_MAX];
+   int status = -1;
+   int i;
+
+   ecore_init();
+   ecore_ipc_init();
+   srv = getcwd(cwd, sizeof(cwd)) ?
+      ecore_ipc_server_connect(ECORE_IPC_LOCAL_USER, (char *) server,
+            0, NULL) : NULL;
+   if (srv)
+     {
+        buf = eina_binbuf_new();
+        eina_binbuf_append_length(buf, (unsigned char *) cwd,
+              strlen(cwd) + 1);
+        for (i = 1; i < argc; i++)
+          {
+             if (_edje_pick_lib_opt_valued(argv[i]) && ((i + 1) < argc))
+               {  /* Its value goes as is */
+                  eina_binbuf_append_length(buf, (unsigned char *) argv[i],
+                        strlen(argv[i]) + 1);
+                  i++;
+               }
+             else if (_edje_pick_opt_value(EDJE_PICK_OPT_CONNECT,
+                      argc, argv, &i))
+               continue;
+
+             eina_binbuf_append_length(buf, (unsigned char *) argv[i],
+                   strlen(argv[i]) + 1);
+          }
+
+        hd = ecore_event_handler_add(ECORE_IPC_EVENT_SERVER_DATA,
+              _edje_pick_client_data, &status);
+        hx = ecore_event_handler_add(ECORE_IPC_EVENT_SERVER_DEL,
+              _edje_pick_client_del, NULL);
+
+        ecore_ipc_server_send(srv, EDJE_PICK_IPC_MAJOR, EDJE_PICK_IPC_RUN,
+              0, 0, 0, eina_binbuf_string_get(buf),
+              eina_binbuf_length_get(buf));
+        ecore_ipc_server_flush(srv);
+        ecore_main_loop_begin();
+
+        ecore_event_handler_del(hd);
+        ecore_event_handler_del(hx);
+        ecore_ipc_server_del(srv);
+        eina_binbuf_free(buf);
+     }
+
+   if (status < 0)  /* While eina is still up, ecore holds it */
+     EINA_LOG_WARN("Daemon '%s' not reachable, running locally\n", server);
+
+   ecore_ipc_shutdown();
+   ecore_shutdown();
+   return status;
+}
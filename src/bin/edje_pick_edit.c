@@ -0,0 +1,455 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Eina.h>
+#include <Eet.h>
+
+#include "edje_pick_eet.h"
+#include "edje_pick_edit.h"
+
+/* Edje_Image_Directory_Entry source_type values, as edje_cc sets them */
+#define EDJE_PICK_EDIT_IMAGE_PERFECT 1
+#define EDJE_PICK_EDIT_IMAGE_LOSSY   2
+
+typedef struct _Edje_Pick_Edit_Node Edje_Pick_Edit_Node;
+struct _Edje_Pick_Edit_Node
+{  /* Statement of the dump: a value, key or count, or a group of them */
+   const char *text;      /* Points in the dump, without ';' or '{' */
+   int len;
+   char *set;             /* Replaces text when not NULL */
+   Eina_Bool group;
+   Eina_Bool removed;
+   Edje_Pick_Edit_Node *parent;
+   Eina_List *children;
+};
+
+struct _Edje_Pick_Edit
+{
+   Eet_File *ef;
+   Eina_Strbuf *dump;          /* edje/file as eet_data_dump() gives it */
+   Edje_Pick_Edit_Node root;   /* Statements of the dump */
+   int compress;               /* How edje/file was stored */
+   Eina_Bool changed;
+};
+
+static void
+_edje_pick_edit_dump(void *data, const char *str)
+{
+   eina_strbuf_append(data, str);
+}
+
+static void
+_edje_pick_edit_node_free(Edje_Pick_Edit_Node *node)
+{  /* Children of node, node itself is owned by its parent */
+   Edje_Pick_Edit_Node *n;
+
+   EINA_LIST_FREE(node->children, n)
+     {
+        _edje_pick_edit_node_free(n);
+        free(n->set);
+        free(n);
+     }
+}
+
+static const char *
+_edje_pick_edit_parse(const char *p, const char *end,
+      Edje_Pick_Edit_Node *parent)
+{  /* Statements up to the '}' closing parent, or to the end of the dump
+      for the root. Returns where parsing stopped, NULL if malformed */
+   Edje_Pick_Edit_Node *n;
+   const char *s;
+   Eina_Bool quoted;
+
+   for (;;)
+     {
+        while ((p < end) && isspace((unsigned char) *p))
+          p++;
+
+        if (p >= end)
+          return parent->parent ? NULL : p;
+
+        if (*p == '}')
+          return parent->parent ? p + 1 : NULL;
+
+        for (s = p, quoted = EINA_FALSE; s < end; s++)
+          {  /* Strings are quoted, with '\' escapes */
+             if (quoted && (*s == '\\') && ((s + 1) < end))
+               s++;
+             else if (*s == '"')
+               quoted = !quoted;
+             else if ((!quoted) && ((*s == ';') || (*s == '{') ||
+                      (*s == '}')))
+               break;
+          }
+
+        if ((s >= end) || (*s == '}'))
+          return NULL;
+
+        n = calloc(1, sizeof(Edje_Pick_Edit_Node));
+        if (!n)
+          return NULL;
+
+        n->text = p;
+        n->len = s - p;
+        while (n->len && isspace((unsigned char) p[n->len - 1]))
+          n->len--;
+
+        n->parent = parent;
+        parent->children = eina_list_append(parent->children, n);
+        p = s + 1;
+        if (*s == '{')
+          {
+             n->group = EINA_TRUE;
+             p = _edje_pick_edit_parse(p, end, n);
+             if (!p)
+               return NULL;
+          }
+     }
+}
+
+static void
+_edje_pick_edit_write(Eina_Strbuf *buf, const Edje_Pick_Edit_Node *node)
+{  /* Dump text of what is left of node's children */
+   const Edje_Pick_Edit_Node *n;
+   const Eina_List *l;
+
+   EINA_LIST_FOREACH(node->children, l, n)
+     {
+        if (n->removed)
+          continue;
+
+        if (n->set)
+          eina_strbuf_append(buf, n->set);
+        else
+          eina_strbuf_append_length(buf, n->text, n->len);
+
+        if (!n->group)
+          {
+             eina_strbuf_append(buf, ";\n");
+             continue;
+          }
+
+        eina_strbuf_append(buf, " {\n");
+        _edje_pick_edit_write(buf, n);
+        eina_strbuf_append(buf, "}\n");
+     }
+}
+
+static Eina_Bool
+_edje_pick_edit_is(const Edje_Pick_Edit_Node *n, const char *word,
+      const char *name)
+{  /* Statement starts with: word "name" */
+   char buf[64];
+   int len;
+
+   len = snprintf(buf, sizeof(buf), "%s \"%s\"", word, name);
+   return ((!n->removed) && (n->len >= len) &&
+         (!strncmp(n->text, buf, len)) &&
+         ((n->len == len) || isspace((unsigned char) n->text[len])));
+}
+
+static Edje_Pick_Edit_Node *
+_edje_pick_edit_find(Edje_Pick_Edit_Node *node, const char *name)
+{  /* Shallowest group called name under node, breadth first */
+   Edje_Pick_Edit_Node *n, *found = NULL;
+   Eina_List *queue = NULL, *l;
+
+   queue = eina_list_append(queue, node);
+   while ((queue) && (!found))
+     {
+        node = eina_list_data_get(queue);
+        queue = eina_list_remove_list(queue, queue);
+        EINA_LIST_FOREACH(node->children, l, n)
+          {
+             if ((!n->group) || n->removed)
+               continue;
+
+             if (_edje_pick_edit_is(n, "group", name))
+               {
+                  found = n;
+                  break;
+               }
+
+             queue = eina_list_append(queue, n);
+          }
+     }
+
+   eina_list_free(queue);
+   return found;
+}
+
+static Edje_Pick_Edit_Node *
+_edje_pick_edit_value(const Edje_Pick_Edit_Node *node, const char *field,
+      const char **v)
+{  /* Value statement of field in node, v set past its ':' */
+   Edje_Pick_Edit_Node *n;
+   const Eina_List *l;
+   const char *colon;
+
+   EINA_LIST_FOREACH(node->children, l, n)
+     {
+        if (n->group || (!_edje_pick_edit_is(n, "value", field)))
+          continue;
+
+        colon = memchr(n->text, ':', n->len);
+        if (!colon)
+          return NULL;
+
+        *v = colon + 1;
+        while ((*v < n->text + n->len) && isspace((unsigned char) **v))
+          (*v)++;
+
+        return n;
+     }
+
+   return NULL;
+}
+
+static Eina_Bool
+_edje_pick_edit_int_is(const Edje_Pick_Edit_Node *node, const char *field,
+      int i)
+{
+   const char *v;
+
+   return (_edje_pick_edit_value(node, field, &v) && (atoi(v) == i));
+}
+
+static Eina_Bool
+_edje_pick_edit_string_is(const Edje_Pick_Edit_Node *node,
+      const char *field, const char *str)
+{  /* Compare the quoted, escaped value with str */
+   Edje_Pick_Edit_Node *n;
+   const char *v, *end;
+
+   n = _edje_pick_edit_value(node, field, &v);
+   if ((!n) || (*v != '"'))
+     return EINA_FALSE;
+
+   end = n->text + n->len;
+   for (v++; (v < end) && (*v != '"'); v++, str++)
+     {
+        if ((*v == '\\') && ((v + 1) < end))
+          v++;
+
+        if (*v != *str)
+          return EINA_FALSE;
+     }
+
+   return ((v < end) && (!*str));
+}
+
+static Eina_Bool
+_edje_pick_edit_int_set(Edje_Pick_Edit_Node *node, const char *field, int i)
+{  /* Same statement, new number after the ':' */
+   Edje_Pick_Edit_Node *n;
+   const char *v;
+   char buf[256];
+
+   n = _edje_pick_edit_value(node, field, &v);
+   if ((!n) || ((v - n->text) >= (int) sizeof(buf) - 16))
+     return EINA_FALSE;
+
+   snprintf(buf, sizeof(buf), "%.*s%i", (int) (v - n->text), n->text, i);
+   free(n->set);
+   n->set = strdup(buf);
+   return (n->set != NULL);
+}
+
+static Edje_Pick_Edit_Node *
+_edje_pick_edit_element(Edje_Pick_Edit *ed, const char *dir,
+      const char *array, const char *field, int id)
+{  /* Element of array in dir whose field is id */
+   Edje_Pick_Edit_Node *a, *n;
+   Eina_List *l;
+
+   a = _edje_pick_edit_find(&ed->root, dir);
+   a = a ? _edje_pick_edit_find(a, array) : NULL;
+   if (!a)
+     return NULL;
+
+   EINA_LIST_FOREACH(a->children, l, n)
+     if (n->group && (!n->removed) && _edje_pick_edit_int_is(n, field, id))
+       return n;
+
+   return NULL;
+}
+
+Edje_Pick_Edit *
+edje_pick_edit_open(const char *file)
+{
+   Edje_Pick_Edit *ed;
+   const char *text;
+   int size;
+
+   ed = calloc(1, sizeof(Edje_Pick_Edit));
+   if (!ed)
+     return NULL;
+
+   ed->ef = eet_open(file, EET_FILE_MODE_READ_WRITE);
+   ed->dump = eina_strbuf_new();
+   if ((!ed->ef) || (!ed->dump) ||
+       (!eet_data_dump(ed->ef, EDJE_PICK_FILE_ENTRY, _edje_pick_edit_dump,
+                       ed->dump)))
+     goto fail;
+
+   text = eina_strbuf_string_get(ed->dump);
+   if (!_edje_pick_edit_parse(text, text + eina_strbuf_length_get(ed->dump),
+            &ed->root))
+     goto fail;
+
+   /* Written back as it was stored */
+   ed->compress = eet_read_direct(ed->ef, EDJE_PICK_FILE_ENTRY, &size) ?
+      EET_COMPRESSION_NONE : EET_COMPRESSION_DEFAULT;
+   return ed;
+
+fail:
+   _edje_pick_edit_node_free(&ed->root);
+   if (ed->dump)
+     eina_strbuf_free(ed->dump);
+
+   if (ed->ef)
+     eet_close(ed->ef);
+
+   free(ed);
+   return NULL;
+}
+
+Eina_Bool
+edje_pick_edit_image_encoding_set(Edje_Pick_Edit *ed, int id,
+      Eina_Bool lossy, int compress, int quality)
+{  /* edje_cc stores lossless images with param 1 compressed, 0 raw,
+      and lossy ones with their quality */
+   Edje_Pick_Edit_Node *n;
+
+   n = _edje_pick_edit_element(ed, "image_dir", "entries", "id", id);
+   if ((!n) ||
+       (!_edje_pick_edit_int_set(n, "source_type", lossy ?
+          EDJE_PICK_EDIT_IMAGE_LOSSY : EDJE_PICK_EDIT_IMAGE_PERFECT)) ||
+       (!_edje_pick_edit_int_set(n, "source_param",
+          lossy ? quality : (compress ? 1 : 0))))
+     return EINA_FALSE;
+
+   ed->changed = EINA_TRUE;
+   return EINA_TRUE;
+}
+
+Eina_Bool
+edje_pick_edit_image_del(Edje_Pick_Edit *ed, int id)
+{  /* Images go by id, the index in the entries array: keep the slot
+      and drop its name, as edje_edit did before renumbering */
+   Edje_Pick_Edit_Node *n, *name;
+   const char *v;
+   char entry[64];
+
+   n = _edje_pick_edit_element(ed, "image_dir", "entries", "id", id);
+   name = n ? _edje_pick_edit_value(n, "entry", &v) : NULL;
+   if (!name)
+     return EINA_FALSE;
+
+   snprintf(entry, sizeof(entry), EDJE_PICK_IMAGE_ENTRY, id);
+   eet_delete(ed->ef, entry);
+   name->removed = EINA_TRUE;
+   ed->changed = EINA_TRUE;
+   return EINA_TRUE;
+}
+
+Eina_Bool
+edje_pick_edit_sample_del(Edje_Pick_Edit *ed, int id)
+{  /* Samples are looked up by name, the element goes away and the
+      array, which carries its length as "count N", gets shorter */
+   Edje_Pick_Edit_Node *n, *count;
+   Eina_List *l;
+   char entry[64];
+   char buf[32];
+
+   n = _edje_pick_edit_element(ed, "sound_dir", "samples", "id", id);
+   if (!n)
+     return EINA_FALSE;
+
+   EINA_LIST_FOREACH(n->parent->children, l, count)
+     if ((!count->group) && (count->len > 6) &&
+         (!strncmp(count->text, "count ", 6)))
+       break;
+
+   if (count)
+     {
+        snprintf(buf, sizeof(buf), "count %i",
+              atoi((count->set ? count->set : count->text) + 6) - 1);
+        free(count->set);
+        count->set = strdup(buf);
+        if (!count->set)
+          return EINA_FALSE;
+     }
+
+   snprintf(entry, sizeof(entry), EDJE_PICK_SAMPLE_ENTRY, id);
+   eet_delete(ed->ef, entry);
+   n->removed = EINA_TRUE;
+   ed->changed = EINA_TRUE;
+   return EINA_TRUE;
+}
+
+Eina_Bool
+edje_pick_edit_font_del(Edje_Pick_Edit *ed, const char *name)
+{  /* Fonts are a hash: one "fonts" group per font, holding its key and
+      its Edje_Font_Directory_Entry */
+   Edje_Pick_Edit_Node *fonts, *n, *f;
+   Eina_List *l, *ll;
+   char entry[PATH_MAX];
+
+   fonts = _edje_pick_edit_find(&ed->root, "fonts");
+   if (!fonts)
+     return EINA_FALSE;
+
+   EINA_LIST_FOREACH(fonts->parent->children, l, n)
+     {
+        if ((!n->group) || (!_edje_pick_edit_is(n, "group", "fonts")))
+          continue;
+
+        EINA_LIST_FOREACH(n->children, ll, f)
+          if (f->group && _edje_pick_edit_string_is(f, "entry", name))
+            break;
+
+        if (!f)
+          continue;
+
+        snprintf(entry, sizeof(entry), EDJE_PICK_FONT_ENTRY, name);
+        eet_delete(ed->ef, entry);
+        n->removed = EINA_TRUE;
+        ed->changed = EINA_TRUE;
+        return EINA_TRUE;
+     }
+
+   return EINA_FALSE;
+}
+
+Eina_Bool
+edje_pick_edit_close(Edje_Pick_Edit *ed)
+{
+   Eina_Strbuf *buf;
+   Eina_Bool ret = EINA_TRUE;
+
+   if (ed->changed)
+     {
+        buf = eina_strbuf_new();
+        _edje_pick_edit_write(buf, &ed->root);
+        ret = eet_data_undump(ed->ef, EDJE_PICK_FILE_ENTRY,
+              eina_strbuf_string_get(buf), eina_strbuf_length_get(buf),
+              ed->compress);
+        eina_strbuf_free(buf);
+     }
+
+   _edje_pick_edit_node_free(&ed->root);
+   eina_strbuf_free(ed->dump);
+   if (eet_close(ed->ef) != EET_ERROR_NONE)
+     ret = EINA_FALSE;
+
+   free(ed);
+   return ret;
+}
@@ -0,0 +1,31 @@
+#ifndef EDJE_PICK_EDIT_H
+#define EDJE_PICK_EDIT_H
+
+#include <Eina.h>
+
+/* Changes to the descriptors of an edje file, the ones edje/file keeps
+   for its images, samples and fonts, and to their data entries. The file
+   is opened once: entries are deleted right away, and edje/file, edited
+   as the text eet_data_dump() gives, is written back once on close. */
+
+typedef struct _Edje_Pick_Edit Edje_Pick_Edit;
+
+/* NULL if file can't be opened to write or has no edje/file */
+Edje_Pick_Edit *edje_pick_edit_open(const char *file);
+
+/* Record how image id is now encoded: lossy with quality, or lossless
+   with compress, 0 for raw */
+Eina_Bool edje_pick_edit_image_encoding_set(Edje_Pick_Edit *ed, int id,
+      Eina_Bool lossy, int compress, int quality);
+
+/* Remove a resource, its data entry and its descriptor. Image ids stay
+   as they are, the descriptor of a removed image is left unnamed */
+Eina_Bool edje_pick_edit_image_del(Edje_Pick_Edit *ed, int id);
+Eina_Bool edje_pick_edit_sample_del(Edje_Pick_Edit *ed, int id);
+Eina_Bool edje_pick_edit_font_del(Edje_Pick_Edit *ed, const char *name);
+
+/* Write edje/file once if anything changed, then free ed. False if
+   writing failed */
+Eina_Bool edje_pick_edit_close(Edje_Pick_Edit *ed);
+
+#endif
@@ -0,0 +1,71 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <Eina.h>
+
+#include "edje_pick_eet.h"
+
+/* eet file directory: magic, entry count and dictionary size, then per
+   entry offset, size, data size, name offset, name size and flags, all
+   big endian */
+#define EDJE_PICK_EET_MAGIC        0x1ee70f42
+#define EDJE_PICK_EET_HEADER_INTS  3
+#define EDJE_PICK_EET_DIR_INTS     6
+#define EDJE_PICK_EET_FLAG_ALIAS   (1 << 2)
+
+Eina_Hash *
+edje_pick_eet_layout(const unsigned char *map, size_t size)
+{
+   Edje_Pick_Extent *e;
+   Eina_Hash *layout;
+   char *name;
+   unsigned int hdr[EDJE_PICK_EET_HEADER_INTS];
+   unsigned int dir[EDJE_PICK_EET_DIR_INTS];
+   unsigned int i, k;
+   size_t pos;
+
+   if (size < sizeof(hdr))
+     return NULL;
+
+   memcpy(hdr, map, sizeof(hdr));
+   for (k = 0; k < EDJE_PICK_EET_HEADER_INTS; k++)
+     hdr[k] = ntohl(hdr[k]);
+
+   if ((hdr[0] != EDJE_PICK_EET_MAGIC) ||
+       (hdr[1] > (size - sizeof(hdr)) / sizeof(dir)))
+     return NULL;
+
+   layout = eina_hash_string_superfast_new(free);
+   for (i = 0; i < hdr[1]; i++)
+     {
+        pos = sizeof(hdr) + (i * sizeof(dir));
+        memcpy(dir, map + pos, sizeof(dir));
+        for (k = 0; k < EDJE_PICK_EET_DIR_INTS; k++)
+          dir[k] = ntohl(dir[k]);
+
+        /* offset, size, data size, name offset, name size, flags */
+        if ((dir[5] & EDJE_PICK_EET_FLAG_ALIAS) || (!dir[1]) || (!dir[4]) ||
+            (dir[0] > size) || (dir[1] > size - dir[0]) ||
+            (dir[3] > size) || (dir[4] > size - dir[3]))
+          continue;
+
+        e = malloc(sizeof(Edje_Pick_Extent));
+        if (!e)
+          continue;
+
+        e->first = dir[0];
+        e->last = dir[0] + dir[1] - 1;
+        name = strndup((const char *) map + dir[3], dir[4]);
+        if ((!name) || (!eina_hash_add(layout, name, e)))
+          free(e);
+
+        free(name);
+     }
+
+   return layout;
+}
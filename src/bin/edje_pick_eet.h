@@ -0,0 +1,35 @@
+#ifndef EDJE_PICK_EET_H
+#define EDJE_PICK_EET_H
+
+#include <stddef.h>
+#include <Eina.h>
+
+/* Entry names of edje files, and their eet layout read without eet */
+
+#define EDJE_PICK_FILE_ENTRY   "edje/file"
+#define EDJE_PICK_IMAGE_ENTRY  "edje/images/%i"
+#define EDJE_PICK_SAMPLE_ENTRY "edje/sounds/%i"
+#define EDJE_PICK_FONT_ENTRY   "edje/fonts/%s"
+#define EDJE_PICK_GROUP_ENTRY  "edje/collections/%i"
+#define EDJE_PICK_IMAGES_GLOB  "edje/images/*"
+#define EDJE_PICK_SAMPLES_GLOB "edje/sounds/*"
+#define EDJE_PICK_FONTS_GLOB   "edje/fonts/*"
+#define EDJE_PICK_GROUPS_GLOB  "edje/collections/*"
+
+/* Directory bytes eet spends on an entry, besides its name */
+#define EDJE_PICK_EET_ENTRY_SIZE 28
+
+typedef struct _Edje_Pick_Extent Edje_Pick_Extent;
+struct _Edje_Pick_Extent
+{  /* Where an entry is stored in an eet file */
+   unsigned int first;   /* First and last byte */
+   unsigned int last;
+};
+
+/* Extents of the entries of the eet file mapped at map, from its
+   directory: entry name to Edje_Pick_Extent. Only the directory is
+   read, so compressed entries cost nothing. Aliases hold no data and
+   are left out. NULL if the file is not in the layout known here. */
+Eina_Hash *edje_pick_eet_layout(const unsigned char *map, size_t size);
+
+#endif
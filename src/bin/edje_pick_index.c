@@ -0,0 +1,464 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#define EDJE_EDIT_IS_UNSTABLE_AND_I_KNOW_ABOUT_IT
+#include <Eina.h>
+#include <Evas.h>
+#include <Ecore_Evas.h>
+#include <Edje.h>
+#include <Edje_Edit.h>
+
+#include "edje_pick_index.h"
+
+typedef struct _Edje_Pick_Index_Group Edje_Pick_Index_Group;
+struct _Edje_Pick_Index_Group
+{
+   const char *name;                        /* stringshare */
+   Eina_List *deps[EDJE_PICK_DEP_LAST];     /* stringshare, no repeats */
+};
+
+struct _Edje_Pick_Index
+{
+   Eina_List *groups;                       /* Names, file order */
+   Eina_Hash *group_hash;                   /* Name to Edje_Pick_Index_Group */
+   Eina_Hash *users[EDJE_PICK_DEP_LAST];    /* Resource to list of groups */
+   Eina_List *file_deps[EDJE_PICK_DEP_LAST];  /* Used by the file itself */
+   Eina_List *sets;                         /* Image set names */
+   Eina_List *fonts;                        /* Font names edje/file lists */
+   const char *file;                        /* stringshare */
+};
+
+static void
+_edje_pick_index_group_free(void *data)
+{
+   Edje_Pick_Index_Group *ig = data;
+   const char *name;
+   unsigned int t;
+
+   for (t = 0; t < EDJE_PICK_DEP_LAST; t++)
+     EINA_LIST_FREE(ig->deps[t], name)
+       eina_stringshare_del(name);
+
+   eina_stringshare_del(ig->name);
+   free(ig);
+}
+
+static void
+_edje_pick_index_users_free(void *data)
+{  /* Names in it belong to the groups */
+   eina_list_free(data);
+}
+
+static void
+_edje_pick_index_dep_add(Edje_Pick_Index *idx, Edje_Pick_Index_Group *ig,
+      Edje_Pick_Dep_Type type, const char *name)
+{
+   Eina_List *users;
+
+   if ((!name) || (!*name))
+     return;
+
+   name = eina_stringshare_add(name);
+   if (eina_list_data_find(ig->deps[type], name))
+     {  /* Already there, stringshare compares by pointer */
+        eina_stringshare_del(name);
+        return;
+     }
+
+   ig->deps[type] = eina_list_append(ig->deps[type], name);
+   users = eina_hash_find(idx->users[type], name);
+   users = eina_list_append(users, ig->name);
+   eina_hash_set(idx->users[type], name, users);
+}
+
+static void
+_edje_pick_index_textblock_scan(Edje_Pick_Index *idx,
+      Edje_Pick_Index_Group *ig, Evas_Object *obj, const char *part)
+{
+   const char *(*source_get[])(Evas_Object *, const char *) = {
+        edje_edit_part_source_get,
+#if (EDJE_VERSION_MAJOR > 1) || (EDJE_VERSION_MINOR >= 15)
+        edje_edit_part_source2_get,
+        edje_edit_part_source3_get,
+        edje_edit_part_source4_get,
+        edje_edit_part_source5_get,
+        edje_edit_part_source6_get
+#endif
+   };
+   const char *name;
+   unsigned int i;
+
+   for (i = 0; i < (sizeof(source_get) / sizeof(source_get[0])); i++)
+     {
+        name = source_get[i](obj, part);
+        _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_GROUP, name);
+        edje_edit_string_free(name);
+     }
+}
+
+static void
+_edje_pick_index_part_scan(Edje_Pick_Index *idx, Edje_Pick_Index_Group *ig,
+      Evas_Object *obj, const char *part)
+{  /* Record what the states of part use */
+   Eina_List *states, *tweens, *items, *l, *ll;
+   const char *state, *name, *tween, *item, *font;
+   Edje_Part_Type type = edje_edit_part_type_get(obj, part);
+   char buf[256];
+   char *sp;
+   double value;
+
+   if (type == EDJE_PART_TYPE_GROUP)
+     {
+        name = edje_edit_part_source_get(obj, part);
+        _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_GROUP, name);
+        edje_edit_string_free(name);
+        return;
+     }
+
+   if (type == EDJE_PART_TYPE_EXTERNAL)
+     {  /* The source names the external type, a group only sometimes */
+        name = edje_edit_part_source_get(obj, part);
+        if (name && edje_file_group_exists(idx->file, name))
+          _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_GROUP, name);
+
+        edje_edit_string_free(name);
+        return;
+     }
+
+   if (type == EDJE_PART_TYPE_TEXTBLOCK)
+     {  /* Selection, cursor and anchor decoration groups */
+        _edje_pick_index_textblock_scan(idx, ig, obj, part);
+        return;
+     }
+
+   if ((type == EDJE_PART_TYPE_BOX) || (type == EDJE_PART_TYPE_TABLE))
+     {  /* Items are instances of their source groups */
+        items = edje_edit_part_items_list_get(obj, part);
+        EINA_LIST_FOREACH(items, l, item)
+          {
+             name = edje_edit_part_item_source_get(obj, part, item);
+             _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_GROUP, name);
+             edje_edit_string_free(name);
+          }
+
+        edje_edit_string_list_free(items);
+        return;
+     }
+
+   if ((type != EDJE_PART_TYPE_IMAGE) && (type != EDJE_PART_TYPE_TEXT))
+     return;
+
+   states = edje_edit_part_states_list_get(obj, part);
+   EINA_LIST_FOREACH(states, l, state)
+     {  /* States are listed as "name value" */
+        snprintf(buf, sizeof(buf), "%s", state);
+        sp = strrchr(buf, ' ');
+        if (!sp)
+          continue;
+
+        *sp = '\0';
+        value = atof(sp + 1);
+        if (type == EDJE_PART_TYPE_TEXT)
+          {  /* "Name:style=...", as in style tags */
+             name = edje_edit_state_font_get(obj, part, buf, value);
+             font = name ? eina_stringshare_add_length(name,
+                   strcspn(name, ":")) : NULL;
+             _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_FONT, font);
+             eina_stringshare_del(font);
+             edje_edit_string_free(name);
+             continue;
+          }
+
+        name = edje_edit_state_image_get(obj, part, buf, value);
+        _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_IMAGE, name);
+        edje_edit_string_free(name);
+
+        tweens = edje_edit_state_tweens_list_get(obj, part, buf, value);
+        EINA_LIST_FOREACH(tweens, ll, tween)
+          _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_IMAGE, tween);
+
+        edje_edit_string_list_free(tweens);
+     }
+
+   edje_edit_string_list_free(states);
+}
+
+static void
+_edje_pick_index_file_dep_add(Edje_Pick_Index *idx, Edje_Pick_Dep_Type type,
+      const char *name, size_t len)
+{
+   const char *dep = eina_stringshare_add_length(name, len);
+
+   if (eina_list_data_find(idx->file_deps[type], dep))
+     eina_stringshare_del(dep);
+   else
+     idx->file_deps[type] = eina_list_append(idx->file_deps[type], dep);
+}
+
+static void
+_edje_pick_index_file_scan(Edje_Pick_Index *idx, Evas_Object *obj)
+{  /* Textblock styles, image sets and fonts belong to the file, not to
+      a group. Style tags name fonts as
+      "font=Name:style=... font_size=..." */
+   Eina_List *styles, *tags, *fonts, *l, *ll;
+   const char *style, *tag, *value, *p, *font;
+
+#if (EDJE_VERSION_MAJOR > 1) || (EDJE_VERSION_MINOR >= 18)
+   Eina_List *sets = edje_edit_image_set_list_get(obj);
+   const char *set;
+
+   EINA_LIST_FOREACH(sets, l, set)
+     idx->sets = eina_list_append(idx->sets, eina_stringshare_add(set));
+
+   edje_edit_string_list_free(sets);
+#endif
+
+   fonts = edje_edit_fonts_list_get(obj);
+   EINA_LIST_FOREACH(fonts, l, font)
+     idx->fonts = eina_list_append(idx->fonts, eina_stringshare_add(font));
+
+   edje_edit_string_list_free(fonts);
+
+   styles = edje_edit_styles_list_get(obj);
+   EINA_LIST_FOREACH(styles, l, style)
+     {
+        tags = edje_edit_style_tags_list_get(obj, style);
+        EINA_LIST_FOREACH(tags, ll, tag)
+          {
+             value = edje_edit_style_tag_value_get(obj, style, tag);
+             for (p = value; p && (p = strstr(p, "font=")); p += 5)
+               if ((p == value) || (p[-1] == ' '))
+                 _edje_pick_index_file_dep_add(idx, EDJE_PICK_DEP_FONT,
+                       p + 5, strcspn(p + 5, ": "));
+
+             edje_edit_string_free(value);
+          }
+
+        edje_edit_string_list_free(tags);
+     }
+
+   edje_edit_string_list_free(styles);
+}
+
+static void
+_edje_pick_index_group_scan(Edje_Pick_Index *idx, Evas_Object *obj,
+      const char *group)
+{
+   Edje_Pick_Index_Group *ig;
+   Eina_List *lst, *l;
+   const char *name;
+
+   ig = calloc(1, sizeof(Edje_Pick_Index_Group));
+   ig->name = eina_stringshare_add(group);
+   eina_hash_add(idx->group_hash, group, ig);
+   idx->groups = eina_list_append(idx->groups, ig->name);
+
+   if (edje_edit_group_alias_is(obj, group))
+     {  /* An alias shares the collection of the group it stands for.
+           Inheritance leaves no edge: edje_cc copies the parent's parts
+           into the group, and they are scanned as its own */
+        name = edje_edit_group_aliased_get(obj, group);
+        _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_GROUP, name);
+        edje_edit_string_free(name);
+     }
+
+   lst = edje_edit_parts_list_get(obj);
+   EINA_LIST_FOREACH(lst, l, name)
+     _edje_pick_index_part_scan(idx, ig, obj, name);
+
+   edje_edit_string_list_free(lst);
+
+   lst = edje_edit_programs_list_get(obj);
+   EINA_LIST_FOREACH(lst, l, name)
+     {
+        const char *sample;
+
+        if (edje_edit_program_action_get(obj, name) !=
+              EDJE_ACTION_TYPE_SOUND_SAMPLE)
+          continue;
+
+        sample = edje_edit_program_sample_name_get(obj, name);
+        _edje_pick_index_dep_add(idx, ig, EDJE_PICK_DEP_SAMPLE, sample);
+        edje_edit_string_free(sample);
+     }
+
+   edje_edit_string_list_free(lst);
+}
+
+Edje_Pick_Index *
+edje_pick_index_new(const char *file)
+{  /* edje_edit needs a canvas, a 1x1 buffer one is enough */
+   Edje_Pick_Index *idx;
+   Ecore_Evas *ee;
+   Evas_Object *obj;
+   Eina_List *groups, *l;
+   const char *group;
+   unsigned int t;
+
+   groups = edje_file_collection_list(file);
+   if (!groups)
+     return NULL;
+
+   ecore_evas_init();
+   ee = ecore_evas_buffer_new(1, 1);
+   if (!ee)
+     {
+        edje_file_collection_list_free(groups);
+        ecore_evas_shutdown();
+        return NULL;
+     }
+
+   idx = calloc(1, sizeof(Edje_Pick_Index));
+   idx->file = eina_stringshare_add(file);
+   idx->group_hash = eina_hash_string_superfast_new(
+         _edje_pick_index_group_free);
+   for (t = 0; t < EDJE_PICK_DEP_LAST; t++)
+     idx->users[t] = eina_hash_stringshared_new(_edje_pick_index_users_free);
+
+   obj = edje_edit_object_add(ecore_evas_get(ee));
+   EINA_LIST_FOREACH(groups, l, group)
+     {
+        if (eina_hash_find(idx->group_hash, group))
+          continue;
+
+        if (!edje_object_file_set(obj, file, group))
+          continue;
+
+        if (!idx->groups)
+          _edje_pick_index_file_scan(idx, obj);
+
+        _edje_pick_index_group_scan(idx, obj, group);
+     }
+
+   evas_object_del(obj);
+   ecore_evas_free(ee);
+   ecore_evas_shutdown();
+   edje_file_collection_list_free(groups);
+   return idx;
+}
+
+void
+edje_pick_index_free(Edje_Pick_Index *idx)
+{
+   const char *name;
+   unsigned int t;
+
+   if (!idx)
+     return;
+
+   for (t = 0; t < EDJE_PICK_DEP_LAST; t++)
+     {
+        eina_hash_free(idx->users[t]);
+        EINA_LIST_FREE(idx->file_deps[t], name)
+          eina_stringshare_del(name);
+     }
+
+   EINA_LIST_FREE(idx->sets, name)
+     eina_stringshare_del(name);
+
+   EINA_LIST_FREE(idx->fonts, name)
+     eina_stringshare_del(name);
+
+   eina_stringshare_del(idx->file);
+   eina_list_free(idx->groups);
+   eina_hash_free(idx->group_hash);  /* Frees the names */
+   free(idx);
+}
+
+const Eina_List *
+edje_pick_index_groups_get(const Edje_Pick_Index *idx)
+{
+   return idx->groups;
+}
+
+const Eina_List *
+edje_pick_index_deps_get(const Edje_Pick_Index *idx, const char *group,
+      Edje_Pick_Dep_Type type)
+{
+   Edje_Pick_Index_Group *ig = eina_hash_find(idx->group_hash, group);
+
+   return ig ? ig->deps[type] : NULL;
+}
+
+const Eina_List *
+edje_pick_index_file_deps_get(const Edje_Pick_Index *idx,
+      Edje_Pick_Dep_Type type)
+{
+   return idx->file_deps[type];
+}
+
+const Eina_List *
+edje_pick_index_image_sets_get(const Edje_Pick_Index *idx)
+{
+   return idx->sets;
+}
+
+const Eina_List *
+edje_pick_index_fonts_get(const Edje_Pick_Index *idx)
+{
+   return idx->fonts;
+}
+
+const Eina_List *
+edje_pick_index_users_get(const Edje_Pick_Index *idx,
+      Edje_Pick_Dep_Type type, const char *name)
+{
+   const Eina_List *users;
+
+   name = eina_stringshare_add(name);
+   users = eina_hash_find(idx->users[type], name);
+   eina_stringshare_del(name);
+   return users;
+}
+
+static void
+_edje_pick_index_reach(const Edje_Pick_Index *idx, const char *group,
+      Eina_Hash *seen, Eina_Hash *set, Edje_Pick_Dep_Type type)
+{  /* Depth first over GROUP dependencies, each group visited once */
+   Edje_Pick_Index_Group *ig;
+   const char *name;
+   Eina_List *l;
+
+   if (eina_hash_find(seen, group))
+     return;
+
+   ig = eina_hash_find(idx->group_hash, group);
+   if (!ig)
+     return;
+
+   eina_hash_add(seen, ig->name, ig->name);
+   if (type == EDJE_PICK_DEP_GROUP)
+     eina_hash_add(set, ig->name, ig->name);
+   else
+     EINA_LIST_FOREACH(ig->deps[type], l, name)
+       if (!eina_hash_find(set, name))
+         eina_hash_add(set, name, name);
+
+   EINA_LIST_FOREACH(ig->deps[EDJE_PICK_DEP_GROUP], l, name)
+     _edje_pick_index_reach(idx, name, seen, set, type);
+}
+
+Eina_Hash *
+edje_pick_index_reachable_get(const Edje_Pick_Index *idx,
+      const Eina_List *groups, Edje_Pick_Dep_Type type)
+{
+   Eina_Hash *seen = eina_hash_string_superfast_new(NULL);
+   Eina_Hash *set = eina_hash_string_superfast_new(NULL);
+   const Eina_List *l;
+   const char *group;
+
+   EINA_LIST_FOREACH(groups, l, group)
+     _edje_pick_index_reach(idx, group, seen, set, type);
+
+   if (groups)
+     EINA_LIST_FOREACH(idx->file_deps[type], l, group)
+       if (!eina_hash_find(set, group))
+         eina_hash_add(set, group, group);
+
+   eina_hash_free(seen);
+   return set;
+}
@@ -0,0 +1,58 @@
+#ifndef EDJE_PICK_INDEX_H
+#define EDJE_PICK_INDEX_H
+
+#include <Eina.h>
+
+/* Dependency index of one .edj file: what each group uses, and which
+   groups use each resource. Built once by walking every group with
+   edje_edit, then queried with hash lookups. */
+
+typedef struct _Edje_Pick_Index Edje_Pick_Index;
+
+enum _Edje_Pick_Dep_Type
+{
+   EDJE_PICK_DEP_IMAGE,   /* Image names, tweens included */
+   EDJE_PICK_DEP_SAMPLE,  /* Sample names played by programs */
+   EDJE_PICK_DEP_FONT,    /* Font names used by text parts */
+   EDJE_PICK_DEP_GROUP,   /* Groups of GROUP and EXTERNAL parts, BOX/TABLE
+                             items, textblock sources, aliased groups */
+   EDJE_PICK_DEP_LAST
+};
+typedef enum _Edje_Pick_Dep_Type Edje_Pick_Dep_Type;
+
+/* NULL if file can't be read. Needs edje initialized. */
+Edje_Pick_Index *edje_pick_index_new(const char *file);
+void edje_pick_index_free(Edje_Pick_Index *idx);
+
+/* Groups of the file, stringshare, in file order */
+const Eina_List *edje_pick_index_groups_get(const Edje_Pick_Index *idx);
+
+/* Direct dependencies of group, stringshare names */
+const Eina_List *edje_pick_index_deps_get(const Edje_Pick_Index *idx,
+      const char *group, Edje_Pick_Dep_Type type);
+
+/* Resources used by the file rather than a group: fonts named in
+   textblock styles */
+const Eina_List *edje_pick_index_file_deps_get(const Edje_Pick_Index *idx,
+      Edje_Pick_Dep_Type type);
+
+/* Names of the image sets of the file, which parts may use as images.
+   Empty with edje older than 1.18. */
+const Eina_List *edje_pick_index_image_sets_get(const Edje_Pick_Index *idx);
+
+/* Names of the fonts declared in the file. Fonts used but not declared
+   are system fonts. */
+const Eina_List *edje_pick_index_fonts_get(const Edje_Pick_Index *idx);
+
+/* Groups directly using resource name of type */
+const Eina_List *edje_pick_index_users_get(const Edje_Pick_Index *idx,
+      Edje_Pick_Dep_Type type, const char *name);
+
+/* Set of names of type reachable from the groups in list, following
+   GROUP dependencies, plus the file dependencies when list is not
+   empty. For EDJE_PICK_DEP_GROUP it holds the groups themselves too.
+   Keys and data are the names; free with eina_hash_free */
+Eina_Hash *edje_pick_index_reachable_get(const Edje_Pick_Index *idx,
+      const Eina_List *groups, Edje_Pick_Dep_Type type);
+
+#endif
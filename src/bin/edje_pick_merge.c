@@ -0,0 +1,380 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Eina.h>
+#include <Eet.h>
+
+#include "edje_pick_merge.h"
+#include "edje_pick_eet.h"
+#include "edje_pick_edit.h"
+
+#define EDJE_PICK_MERGE_PROG "edje_pick"
+
+static const char *_edje_pick_merge_entry_fmt[EDJE_PICK_DEP_GROUP] = {
+     EDJE_PICK_IMAGE_ENTRY, EDJE_PICK_SAMPLE_ENTRY, EDJE_PICK_FONT_ENTRY
+};
+
+typedef struct _Edje_Pick_Merge_Input Edje_Pick_Merge_Input;
+struct _Edje_Pick_Merge_Input
+{
+   const char *file;     /* stringshare */
+   Eina_Bool all;        /* -a, groups are then ignored */
+   Eina_List *groups;    /* stringshare */
+};
+
+typedef struct _Edje_Pick_Merge_Replace Edje_Pick_Merge_Replace;
+struct _Edje_Pick_Merge_Replace
+{
+   Edje_Pick_Dep_Type type;
+   const char *name;     /* stringshare, resource in output */
+   const char *file;     /* stringshare, file to take it from */
+   int src_id;           /* Image or sample there */
+   const char *src_name; /* stringshare, font there */
+};
+
+typedef struct _Edje_Pick_Merge_Encoding Edje_Pick_Merge_Encoding;
+struct _Edje_Pick_Merge_Encoding
+{  /* How a replaced image is now encoded, for its descriptor */
+   int id;               /* Image in output */
+   Eina_Bool lossy;
+   int compress;
+   int quality;
+};
+
+struct _Edje_Pick_Merge
+{
+   const char *output;   /* stringshare */
+   Eina_List *inputs;    /* Edje_Pick_Merge_Input, first added first */
+   Eina_Hash *files;     /* File name to its Edje_Pick_Merge_Input */
+   Eina_List *replaces;  /* Edje_Pick_Merge_Replace */
+   unsigned int argc;    /* argv needed so far, kept as inputs are added */
+};
+
+Edje_Pick_Merge *
+edje_pick_merge_new(const char *output)
+{
+   Edje_Pick_Merge *m = calloc(1, sizeof(Edje_Pick_Merge));
+
+   m->output = eina_stringshare_add(output);
+   m->files = eina_hash_string_superfast_new(NULL);
+   m->argc = 3;  /* Program name, -o output */
+   return m;
+}
+
+void
+edje_pick_merge_free(Edje_Pick_Merge *m)
+{
+   Edje_Pick_Merge_Replace *r;
+   Edje_Pick_Merge_Input *in;
+   const char *group;
+
+   if (!m)
+     return;
+
+   EINA_LIST_FREE(m->inputs, in)
+     {
+        EINA_LIST_FREE(in->groups, group)
+          eina_stringshare_del(group);
+
+        eina_stringshare_del(in->file);
+        free(in);
+     }
+
+   EINA_LIST_FREE(m->replaces, r)
+     {
+        eina_stringshare_del(r->name);
+        eina_stringshare_del(r->file);
+        eina_stringshare_del(r->src_name);
+        free(r);
+     }
+
+   eina_hash_free(m->files);
+   eina_stringshare_del(m->output);
+   free(m);
+}
+
+static Edje_Pick_Merge_Input *
+_edje_pick_merge_input_get(Edje_Pick_Merge *m, const char *file)
+{
+   Edje_Pick_Merge_Input *in = eina_hash_find(m->files, file);
+
+   if (in)
+     return in;
+
+   in = calloc(1, sizeof(Edje_Pick_Merge_Input));
+   in->file = eina_stringshare_add(file);
+   eina_hash_add(m->files, file, in);
+   m->inputs = eina_list_append(m->inputs, in);
+   m->argc += 2;  /* -i or -a, file */
+   return in;
+}
+
+void
+edje_pick_merge_group_add(Edje_Pick_Merge *m, const char *file,
+      const char *group)
+{
+   Edje_Pick_Merge_Input *in = _edje_pick_merge_input_get(m, file);
+
+   in->groups = eina_list_append(in->groups, eina_stringshare_add(group));
+   m->argc += 2;  /* -g group */
+}
+
+void
+edje_pick_merge_file_add(Edje_Pick_Merge *m, const char *file)
+{
+   _edje_pick_merge_input_get(m, file)->all = EINA_TRUE;
+}
+
+void
+edje_pick_merge_replace_add(Edje_Pick_Merge *m, Edje_Pick_Dep_Type type,
+      const char *name, const char *file, int src_id, const char *src_name)
+{
+   Edje_Pick_Merge_Replace *r;
+
+   if (type >= EDJE_PICK_DEP_GROUP)
+     return;
+
+   r = calloc(1, sizeof(Edje_Pick_Merge_Replace));
+   r->type = type;
+   r->name = eina_stringshare_add(name);
+   r->file = eina_stringshare_add(file);
+   r->src_id = src_id;
+   r->src_name = eina_stringshare_add(src_name);
+   m->replaces = eina_list_append(m->replaces, r);
+}
+
+static char **
+_edje_pick_merge_argv_make(const Edje_Pick_Merge *m, int *argc)
+{  /* Size is known from the spec, strings are the stringshares in it */
+   Edje_Pick_Merge_Input *in;
+   const char *group;
+   Eina_List *l, *ll;
+   char **argv = calloc(m->argc + 1, sizeof(char *));
+   int n = 0;
+
+   argv[n++] = EDJE_PICK_MERGE_PROG;
+   EINA_LIST_FOREACH(m->inputs, l, in)
+     {
+        argv[n++] = in->all ? "-a" : "-i";
+        argv[n++] = (char *) in->file;
+        if (in->all)
+          continue;
+
+        EINA_LIST_FOREACH(in->groups, ll, group)
+          {
+             argv[n++] = "-g";
+             argv[n++] = (char *) group;
+          }
+     }
+
+   argv[n++] = "-o";
+   argv[n++] = (char *) m->output;
+   *argc = n;
+   return argv;
+}
+
+static Eina_Hash *
+_edje_pick_merge_ids_get(Eina_List *lst)
+{  /* Resource name to its image_info_ex (same layout for samples) */
+   Eina_Hash *h = eina_hash_string_superfast_new(NULL);
+   image_info_ex *ex;
+   Eina_List *l;
+
+   EINA_LIST_FOREACH(lst, l, ex)
+     eina_hash_add(h, ex->name, ex);
+
+   return h;
+}
+
+static void
+_edje_pick_merge_source_free(void *data)
+{
+   eet_close(data);
+}
+
+static Eina_Bool
+_edje_pick_merge_entry_copy(Eet_File *in, const char *src,
+      Eet_File *out, const char *dst)
+{  /* Raw copy, resources carry their own encoding */
+   const void *data;
+   void *copy = NULL;
+   int compress = EET_COMPRESSION_NONE;
+   int size;
+   Eina_Bool ret;
+
+   data = eet_read_direct(in, src, &size);
+   if (!data)
+     {
+        data = copy = eet_read(in, src, &size);
+        compress = EET_COMPRESSION_DEFAULT;
+     }
+
+   ret = data && (eet_write(out, dst, data, size, compress) > 0);
+   free(copy);
+   return ret;
+}
+
+static Eina_Bool
+_edje_pick_merge_encoding_get(Eet_File *in, const char *src, int id,
+      Edje_Pick_Merge_Encoding *enc)
+{  /* False if src is not an image edje/file can describe */
+   Eet_Image_Encoding lossy;
+   unsigned int w, h;
+   int alpha;
+
+   if ((!eet_data_image_header_read(in, src, &w, &h, &alpha, &enc->compress,
+               &enc->quality, &lossy)) ||
+       ((lossy != EET_IMAGE_LOSSLESS) && (lossy != EET_IMAGE_JPEG)))
+     return EINA_FALSE;
+
+   enc->id = id;
+   enc->lossy = (lossy == EET_IMAGE_JPEG);
+   return EINA_TRUE;
+}
+
+static Eina_Bool
+_edje_pick_merge_describe(const char *output,
+      const Edje_Pick_Merge_Encoding *enc, unsigned int count)
+{  /* Replaced images keep the descriptor of the ones merged, which
+      names their encoding. Set it to what was written instead. */
+   Edje_Pick_Edit *ed;
+   unsigned int i;
+
+   ed = edje_pick_edit_open(output);
+   if (!ed)
+     return EINA_FALSE;
+
+   for (i = 0; i < count; i++)
+     if (!edje_pick_edit_image_encoding_set(ed, enc[i].id, enc[i].lossy,
+              enc[i].compress, enc[i].quality))
+       EINA_LOG_ERR("Failed to describe encoding of image %d\n", enc[i].id);
+
+   return edje_pick_edit_close(ed);
+}
+
+static Edje_Pick_Status
+_edje_pick_merge_replaces_apply(Edje_Pick_Merge *m)
+{  /* edje_pick_process() has no replacements, so they are written over
+      the merged entries, then images are described as encoded in their
+      source. Source files are opened once each. */
+   Eina_List *grp = NULL, *img = NULL, *smp = NULL, *fnt = NULL;
+   Edje_Pick_Status status = EDJE_PICK_FAILED_OPEN_OUT;
+   Eina_Hash *ids[EDJE_PICK_DEP_FONT];
+   Edje_Pick_Merge_Encoding *enc = NULL;
+   Edje_Pick_Merge_Replace *r;
+   Eina_Hash *sources;
+   image_info_ex *ex;
+   Eet_File *in, *out;
+   Eina_List *l;
+   char src[PATH_MAX];
+   char dst[PATH_MAX];
+   unsigned int n = 0;
+   void *p;
+
+   if (edje_pick_file_info_read(m->output, &grp, &img, &smp, &fnt) !=
+         EDJE_PICK_NO_ERROR)
+     return status;
+
+   out = eet_open(m->output, EET_FILE_MODE_READ_WRITE);
+   if (!out)
+     goto end;
+
+   status = EDJE_PICK_NO_ERROR;
+   enc = malloc(eina_list_count(m->replaces) *
+         sizeof(Edje_Pick_Merge_Encoding));
+   ids[EDJE_PICK_DEP_IMAGE] = _edje_pick_merge_ids_get(img);
+   ids[EDJE_PICK_DEP_SAMPLE] = _edje_pick_merge_ids_get(smp);
+   sources = eina_hash_string_superfast_new(_edje_pick_merge_source_free);
+   EINA_LIST_FOREACH(m->replaces, l, r)
+     {
+        in = eina_hash_find(sources, r->file);
+        if (!in)
+          {
+             in = eet_open(r->file, EET_FILE_MODE_READ);
+             if (!in)
+               {
+                  EINA_LOG_ERR("Failed to open '%s' for replacing '%s'\n",
+                        r->file, r->name);
+                  status = EDJE_PICK_FAILED_OPEN_INP;
+                  continue;
+               }
+
+             eina_hash_add(sources, r->file, in);
+          }
+
+        if (r->type == EDJE_PICK_DEP_FONT)
+          {
+             snprintf(src, sizeof(src), _edje_pick_merge_entry_fmt[r->type],
+                   r->src_name);
+             snprintf(dst, sizeof(dst), _edje_pick_merge_entry_fmt[r->type],
+                   r->name);
+          }
+        else
+          {
+             ex = eina_hash_find(ids[r->type], r->name);
+             if (!ex)
+               continue;  /* Not in output, nothing to replace */
+
+             snprintf(src, sizeof(src), _edje_pick_merge_entry_fmt[r->type],
+                   r->src_id);
+             snprintf(dst, sizeof(dst), _edje_pick_merge_entry_fmt[r->type],
+                   ex->id);
+          }
+
+        if (!_edje_pick_merge_entry_copy(in, src, out, dst))
+          EINA_LOG_ERR("Failed to replace '%s' from '%s'\n", r->name, r->file);
+        else if ((enc) && (r->type == EDJE_PICK_DEP_IMAGE) &&
+                 (_edje_pick_merge_encoding_get(in, src, ex->id, &enc[n])))
+          n++;
+     }
+
+   eina_hash_free(sources);
+   eina_hash_free(ids[EDJE_PICK_DEP_IMAGE]);
+   eina_hash_free(ids[EDJE_PICK_DEP_SAMPLE]);
+   if (eet_close(out) != EET_ERROR_NONE)
+     status = EDJE_PICK_FAILED_CLOSE_OUT;
+   else if ((n) && (!_edje_pick_merge_describe(m->output, enc, n)))
+     {  /* Entries are written, edje/file is rewritten on its own */
+        EINA_LOG_ERR("Failed to describe replaced images in '%s'\n",
+              m->output);
+        status = EDJE_PICK_FAILED_CLOSE_OUT;
+     }
+
+   free(enc);
+
+end:
+   eina_list_free(grp);
+   EINA_LIST_FREE(img, p)
+     free(p);
+
+   EINA_LIST_FREE(smp, p)
+     free(p);
+
+   EINA_LIST_FREE(fnt, p)
+     free(p);
+
+   return status;
+}
+
+Edje_Pick_Status
+edje_pick_merge_run(Edje_Pick_Merge *m)
+{
+   Edje_Pick_Status status;
+   char **argv;
+   int argc;
+
+   argv = _edje_pick_merge_argv_make(m, &argc);
+   status = edje_pick_process(argc, argv);
+   free(argv);
+
+   if ((status == EDJE_PICK_NO_ERROR) && m->replaces)
+     status = _edje_pick_merge_replaces_apply(m);
+
+   return status;
+}
@@ -0,0 +1,34 @@
+#ifndef EDJE_PICK_MERGE_H
+#define EDJE_PICK_MERGE_H
+
+#include <Eina.h>
+#include "Edje_Pick.h"
+#include "edje_pick_index.h"
+
+/* Merge spec: what to build, filled in directly by embedders instead of
+   composing an edje_pick command line. Inputs keep the order they were
+   first added in, groups of one input are kept together. */
+
+typedef struct _Edje_Pick_Merge Edje_Pick_Merge;
+
+Edje_Pick_Merge *edje_pick_merge_new(const char *output);
+void edje_pick_merge_free(Edje_Pick_Merge *m);
+
+/* Take group of file (-i file -g group) */
+void edje_pick_merge_group_add(Edje_Pick_Merge *m, const char *file,
+      const char *group);
+
+/* Take all groups of file (-a file) */
+void edje_pick_merge_file_add(Edje_Pick_Merge *m, const char *file);
+
+/* Replace the content of resource name of type (image, sample or font)
+   in the output with a resource of file. Images and samples are given
+   by src_id, fonts by src_name. */
+void edje_pick_merge_replace_add(Edje_Pick_Merge *m, Edje_Pick_Dep_Type type,
+      const char *name, const char *file, int src_id, const char *src_name);
+
+/* Build the output. Use edje_pick_context_set() before, as with
+   edje_pick_process(). */
+Edje_Pick_Status edje_pick_merge_run(Edje_Pick_Merge *m);
+
+#endif
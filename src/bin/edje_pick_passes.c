@@ -0,0 +1,1406 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <utime.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <Eina.h>
+#include <Eet.h>
+#include <Edje.h>
+
+#include "Edje_Pick.h"
+#include "edje_pick_private.h"
+#include "edje_pick_index.h"
+#include "edje_pick_resample.h"
+#include "edje_pick_variants.h"
+#include "edje_pick_alpha.h"
+#include "edje_pick_eet.h"
+#include "edje_pick_edit.h"
+
+/* The passes run on an output after edje_pick_process() merged it */
+
+typedef struct _Edje_Pick_Entry Edje_Pick_Entry;
+struct _Edje_Pick_Entry
+{  /* Output entry as seen by the post-merge passes */
+   const char *name;   /* Owned by the eet file */
+   const void *data;
+   void *copy;         /* Set when data had to be decompressed */
+   int size;
+   unsigned long long hash;
+   Eina_Bool loaded;   /* Read fine; data may be dropped under a budget */
+};
+
+typedef struct _Edje_Pick_Entries Edje_Pick_Entries;
+struct _Edje_Pick_Entries
+{
+   Eet_File *ef;
+   Edje_Pick_Entry *e;   /* Sorted by name */
+   unsigned int count;
+   Edje_Pick_Budget *budget;   /* When set, copies are not kept */
+};
+
+typedef struct _Edje_Pick_Image Edje_Pick_Image;
+struct _Edje_Pick_Image
+{  /* Output image as encoded again by a recompress worker */
+   const char *name;   /* Owned by the eet_list() result */
+   void *data;         /* New encoding, NULL to keep the current one */
+   int size;
+   int old_size;
+   Eina_Bool opaque;   /* Alpha dropped, keep data even if not smaller */
+   Eina_Bool recoded;  /* Encoding changed, edje/file must say so */
+   Eet_Image_Encoding lossy;
+};
+
+typedef struct _Edje_Pick_Images Edje_Pick_Images;
+struct _Edje_Pick_Images
+{
+   Edje_Pick_Opts *o;
+   Eet_File *ef;
+   Edje_Pick_Image *img;
+   unsigned int count;
+};
+
+typedef struct _Edje_Pick_Scales Edje_Pick_Scales;
+struct _Edje_Pick_Scales
+{  /* Output images and their --scales variants */
+   Edje_Pick_Opts *o;
+   Eet_File *ef;
+   const char **entries;       /* Entry of each image, stringshare */
+   Edje_Pick_Variant *v;       /* scales_count per image, same order */
+   unsigned int count;         /* Images */
+};
+
+typedef struct _Edje_Pick_Check Edje_Pick_Check;
+struct _Edje_Pick_Check
+{  /* Output resource as checked by a verify worker */
+   Edje_Pick_Dep_Type type;
+   const char *name;    /* Resource name, owned by the info lists */
+   const char *entry;   /* stringshare */
+   Eina_Bool ok;
+};
+
+typedef struct _Edje_Pick_Checks Edje_Pick_Checks;
+struct _Edje_Pick_Checks
+{
+   Edje_Pick_Opts *o;
+   Eet_File *ef;
+   Edje_Pick_Check *c;
+   unsigned int count;
+};
+
+static void
+_edje_pick_info_free(Eina_List *grp, Eina_List *img,
+      Eina_List *smp, Eina_List *fnt)
+{  /* Free lists returned by edje_pick_file_info_read() */
+   void *ex;
+
+   eina_list_free(grp);
+   EINA_LIST_FREE(img, ex)
+     free(ex);
+
+   EINA_LIST_FREE(smp, ex)
+     free(ex);
+
+   EINA_LIST_FREE(fnt, ex)
+     free(ex);
+}
+
+static Eina_Bool
+_edje_pick_gc_resolved(Eina_Hash *reach, Eina_List *lst)
+{  /* Check every reachable name is a resource of the file. Names the
+      index can't resolve (image sets) hide what they use, so then
+      nothing of that type may be dropped. */
+   Eina_Hash *names = eina_hash_string_superfast_new(NULL);
+   Eina_Iterator *it;
+   image_info_ex *ex;
+   const char *name;
+   Eina_Bool ret = EINA_TRUE;
+   Eina_List *l;
+
+   EINA_LIST_FOREACH(lst, l, ex)
+     eina_hash_add(names, ex->name, ex);
+
+   it = eina_hash_iterator_key_new(reach);
+   EINA_ITERATOR_FOREACH(it, name)
+     if (!eina_hash_find(names, name))
+       {
+          EINA_LOG_INFO("'%s' is not a resource, keeping all\n", name);
+          ret = EINA_FALSE;
+          break;
+       }
+
+   eina_iterator_free(it);
+   eina_hash_free(names);
+   return ret;
+}
+
+static unsigned int
+_edje_pick_gc_list(Edje_Pick_Edit *ed, Eina_Hash *reach, Eina_List *lst,
+      Eina_Bool (*del)(Edje_Pick_Edit *ed, int id))
+{  /* Delete the images or samples in lst not in reach, by id */
+   image_info_ex *ex;
+   unsigned int n = 0;
+   Eina_List *l;
+
+   if (!_edje_pick_gc_resolved(reach, lst))
+     return 0;
+
+   EINA_LIST_FOREACH(lst, l, ex)
+     if ((!eina_hash_find(reach, ex->name)) && del(ed, ex->id))
+       n++;
+
+   return n;
+}
+
+unsigned long long
+_edje_pick_gc(Edje_Pick_Opts *o, unsigned int *count)
+{  /* Drop output resources not reachable from any output group, which
+      are all groups selected, with their descriptors in edje/file.
+      One eet session for all deletions, edje/file written once.
+      Returns bytes removed from the output. */
+   Eina_List *grp = NULL, *img = NULL, *smp = NULL, *fnt = NULL;
+   const Eina_List *groups;
+   Edje_Pick_Index *idx;
+   Edje_Pick_Edit *ed;
+   Eina_Hash *reach;
+   font_info_ex *fe;
+   Eina_List *l;
+   struct stat before, after;
+   unsigned long long removed = 0;
+
+   *count = 0;
+   edje_init();
+   idx = edje_pick_index_new(o->output);
+   if ((!idx) || stat(o->output, &before) ||
+         (edje_pick_file_info_read(o->output, &grp, &img, &smp, &fnt) !=
+          EDJE_PICK_NO_ERROR))
+     goto end;
+
+   ed = edje_pick_edit_open(o->output);
+   if (!ed)
+     goto end;
+
+   groups = edje_pick_index_groups_get(idx);
+   reach = edje_pick_index_reachable_get(idx, groups, EDJE_PICK_DEP_IMAGE);
+   *count += _edje_pick_gc_list(ed, reach, img, edje_pick_edit_image_del);
+   eina_hash_free(reach);
+
+   reach = edje_pick_index_reachable_get(idx, groups, EDJE_PICK_DEP_SAMPLE);
+   *count += _edje_pick_gc_list(ed, reach, smp, edje_pick_edit_sample_del);
+   eina_hash_free(reach);
+
+   /* Text parts may name system fonts, only embedded ones are dropped */
+   reach = edje_pick_index_reachable_get(idx, groups, EDJE_PICK_DEP_FONT);
+   EINA_LIST_FOREACH(fnt, l, fe)
+     if ((!eina_hash_find(reach, fe->name)) &&
+         edje_pick_edit_font_del(ed, fe->name))
+       (*count)++;
+
+   eina_hash_free(reach);
+   if (!edje_pick_edit_close(ed))
+     EINA_LOG_ERR("Failed to write '%s' of '%s'", EDJE_PICK_FILE_ENTRY,
+           o->output);
+
+   if ((!stat(o->output, &after)) && (after.st_size < before.st_size))
+     removed = before.st_size - after.st_size;
+
+   _edje_pick_report(o,
+         "GC: %u unused resources dropped, %llu bytes removed\n",
+         *count, removed);
+
+end:
+   _edje_pick_info_free(grp, img, smp, fnt);
+   edje_pick_index_free(idx);
+   edje_shutdown();
+   return removed;
+}
+
+static void
+_edje_pick_check_run(void *data, unsigned int idx)
+{  /* Worker: read one resource, and decode it if it is an image */
+   Edje_Pick_Checks *cs = data;
+   Edje_Pick_Check *c = &cs->c[idx];
+   const void *cur;
+   void *copy = NULL;
+   void *pixels;
+   unsigned int w, h;
+   int size, alpha, compress, quality;
+   Eet_Image_Encoding lossy;
+   unsigned long long held;
+
+   cur = eet_read_direct(cs->ef, c->entry, &size);
+   if (!cur)
+     cur = copy = eet_read(cs->ef, c->entry, &size);
+
+   if ((!cur) || (size <= 0))
+     goto end;
+
+   if (c->type != EDJE_PICK_DEP_IMAGE)
+     {  /* Samples and fonts are decoded by their players only */
+        c->ok = EINA_TRUE;
+        goto end;
+     }
+
+   if (!eet_data_image_header_decode(cur, size, &w, &h,
+            &alpha, &compress, &quality, &lossy))
+     goto end;
+
+   held = (unsigned long long) w * h * 4;
+   _edje_pick_budget_take(cs->o->budget, held);
+   pixels = eet_data_image_decode(cur, size, &w, &h,
+         &alpha, &compress, &quality, &lossy);
+   c->ok = (pixels != NULL);
+   free(pixels);
+   _edje_pick_budget_release(cs->o->budget, held);
+
+end:
+   free(copy);
+}
+
+static Eina_Hash *
+_edje_pick_names_hash(const Eina_List *lst, Eina_Bool fonts)
+{  /* Name to image_info_ex, sample_info_ex or font_info_ex */
+   Eina_Hash *h = eina_hash_string_superfast_new(NULL);
+   const Eina_List *l;
+   void *ex;
+
+   EINA_LIST_FOREACH(lst, l, ex)
+     eina_hash_add(h, fonts ? ((font_info_ex *) ex)->name :
+           ((image_info_ex *) ex)->name, ex);
+
+   return h;
+}
+
+static unsigned int
+_edje_pick_verify_deps(Eina_List **checks, Eina_Hash **seen,
+      Eina_Hash **names, Eina_Hash *sets, Eina_Hash *fonts,
+      const char *group, Edje_Pick_Dep_Type type, const Eina_List *deps)
+{  /* Queue the resources in deps for checking once each, return how
+      many do not resolve. Fonts the file does not declare are system
+      ones. */
+   static const char *fmt[EDJE_PICK_DEP_GROUP] = {
+        EDJE_PICK_IMAGE_ENTRY, EDJE_PICK_SAMPLE_ENTRY, EDJE_PICK_FONT_ENTRY
+   };
+   static const char *what[EDJE_PICK_DEP_GROUP] = {
+        "image", "sample", "font"
+   };
+   Edje_Pick_Check *c;
+   const Eina_List *l;
+   const char *name;
+   image_info_ex *ex;
+   unsigned int problems = 0;
+
+   EINA_LIST_FOREACH(deps, l, name)
+     {
+        ex = eina_hash_find(names[type], name);
+        if (!ex)
+          {
+             if (((type == EDJE_PICK_DEP_FONT) &&
+                    (!eina_hash_find(fonts, name))) ||
+                   ((type == EDJE_PICK_DEP_IMAGE) &&
+                    eina_hash_find(sets, name)))
+               continue;
+
+             EINA_LOG_ERR("Group '%s' uses %s '%s', not in the file\n",
+                   group, what[type], name);
+             problems++;
+             continue;
+          }
+
+        if (eina_hash_find(seen[type], name))
+          continue;
+
+        eina_hash_add(seen[type], name, ex);
+        c = calloc(1, sizeof(Edje_Pick_Check));
+        c->type = type;
+        c->name = name;
+        if (type == EDJE_PICK_DEP_FONT)
+          c->entry = eina_stringshare_printf(fmt[type],
+                ((font_info_ex *) ex)->name);
+        else
+          c->entry = eina_stringshare_printf(fmt[type], ex->id);
+
+        *checks = eina_list_append(*checks, c);
+     }
+
+   return problems;
+}
+
+unsigned int
+_edje_pick_verify(Edje_Pick_Opts *o, unsigned int *count)
+{  /* Load every group of the output with edje, in this thread as edje
+      wants, then read and decode what they use across the worker pool.
+      Returns the number of problems found, each is logged. */
+   Eina_List *grp = NULL, *img = NULL, *smp = NULL, *fnt = NULL;
+   Eina_Hash *names[EDJE_PICK_DEP_GROUP];
+   Eina_Hash *seen[EDJE_PICK_DEP_GROUP];
+   Eina_Hash *loaded, *sets, *fonts;
+   Eina_List *groups, *checks = NULL, *l;
+   const Eina_List *ll;
+   const char *group, *name;
+   Edje_Pick_Index *idx;
+   Edje_Pick_Checks cs;
+   Edje_Pick_Check *c;
+   unsigned int problems = 0;
+   unsigned int t, i;
+   double t0 = _edje_pick_time_get();
+
+   *count = 0;
+   edje_init();
+   groups = edje_file_collection_list(o->output);
+   idx = edje_pick_index_new(o->output);
+   if ((!idx) || (edje_pick_file_info_read(o->output,
+               &grp, &img, &smp, &fnt) != EDJE_PICK_NO_ERROR))
+     {
+        EINA_LOG_ERR("Failed to read '%s' for verifying\n", o->output);
+        edje_file_collection_list_free(groups);
+        edje_pick_index_free(idx);
+        edje_shutdown();
+        return 1;
+     }
+
+   loaded = eina_hash_string_superfast_new(NULL);
+   EINA_LIST_FOREACH(edje_pick_index_groups_get(idx), ll, name)
+     eina_hash_add(loaded, name, name);
+
+   sets = eina_hash_string_superfast_new(NULL);
+   EINA_LIST_FOREACH(edje_pick_index_image_sets_get(idx), ll, name)
+     eina_hash_add(sets, name, name);
+
+   fonts = eina_hash_string_superfast_new(NULL);
+   EINA_LIST_FOREACH(edje_pick_index_fonts_get(idx), ll, name)
+     eina_hash_add(fonts, name, name);
+
+   names[EDJE_PICK_DEP_IMAGE] = _edje_pick_names_hash(img, EINA_FALSE);
+   names[EDJE_PICK_DEP_SAMPLE] = _edje_pick_names_hash(smp, EINA_FALSE);
+   names[EDJE_PICK_DEP_FONT] = _edje_pick_names_hash(fnt, EINA_TRUE);
+   for (t = 0; t < EDJE_PICK_DEP_GROUP; t++)
+     seen[t] = eina_hash_string_superfast_new(NULL);
+
+   EINA_LIST_FOREACH(groups, l, group)
+     {
+        if (!eina_hash_find(loaded, group))
+          {
+             EINA_LOG_ERR("Group '%s' does not load\n", group);
+             problems++;
+             continue;
+          }
+
+        for (t = 0; t < EDJE_PICK_DEP_GROUP; t++)
+          problems += _edje_pick_verify_deps(&checks, seen, names, sets,
+                fonts, group, t, edje_pick_index_deps_get(idx, group, t));
+
+        EINA_LIST_FOREACH(edje_pick_index_deps_get(idx, group,
+                 EDJE_PICK_DEP_GROUP), ll, name)
+          if (!eina_hash_find(loaded, name))
+            {
+               EINA_LOG_ERR("Group '%s' embeds group '%s', not in the "
+                     "file\n", group, name);
+               problems++;
+            }
+     }
+
+   problems += _edje_pick_verify_deps(&checks, seen, names, sets, fonts,
+         o->output, EDJE_PICK_DEP_FONT,
+         edje_pick_index_file_deps_get(idx, EDJE_PICK_DEP_FONT));
+
+   cs.o = o;
+   cs.count = eina_list_count(checks);
+   cs.c = calloc(cs.count ? cs.count : 1, sizeof(Edje_Pick_Check));
+   i = 0;
+   EINA_LIST_FREE(checks, c)
+     {
+        cs.c[i++] = *c;
+        free(c);
+     }
+
+   cs.ef = eet_open(o->output, EET_FILE_MODE_READ);
+   if (cs.ef)
+     {
+        _edje_pick_jobs_run(o->jobs, cs.count, _edje_pick_check_run, &cs);
+        eet_close(cs.ef);
+     }
+
+   for (i = 0; i < cs.count; i++)
+     {
+        if (!cs.c[i].ok)
+          {
+             EINA_LOG_ERR("'%s' (%s) does not read or decode\n",
+                   cs.c[i].name, cs.c[i].entry);
+             problems++;
+          }
+
+        eina_stringshare_del(cs.c[i].entry);
+     }
+
+   *count = cs.count;
+   _edje_pick_report(o,
+         "Verify: %u groups, %u resources, %u problems in %.3f s\n",
+         eina_list_count(groups), cs.count, problems,
+         _edje_pick_time_get() - t0);
+
+   free(cs.c);
+   for (t = 0; t < EDJE_PICK_DEP_GROUP; t++)
+     {
+        eina_hash_free(seen[t]);
+        eina_hash_free(names[t]);
+     }
+
+   eina_hash_free(fonts);
+   eina_hash_free(sets);
+   eina_hash_free(loaded);
+   _edje_pick_info_free(grp, img, smp, fnt);
+   edje_pick_index_free(idx);
+   edje_file_collection_list_free(groups);
+   edje_shutdown();
+   return problems;
+}
+
+static Eina_Bool
+_edje_pick_entry_is_alias(Eet_File *ef, const char *name)
+{  /* eet_alias_get() hands out a stringshare */
+   const char *alias = eet_alias_get(ef, name);
+
+   eina_stringshare_del(alias);
+   return (alias != NULL);
+}
+
+static int
+_edje_pick_entry_cmp(const void *d1, const void *d2)
+{
+   return strcmp(((const Edje_Pick_Entry *) d1)->name,
+         ((const Edje_Pick_Entry *) d2)->name);
+}
+
+static void
+_edje_pick_entry_load(void *data, unsigned int idx)
+{  /* Worker: fetch one entry and hash its stored payload */
+   Edje_Pick_Entries *es = data;
+   Edje_Pick_Entry *e = &es->e[idx];
+
+   e->data = eet_read_direct(es->ef, e->name, &e->size);
+   if (e->data)
+     {  /* Points into the file mapping, nothing to account */
+        e->hash = _edje_pick_hash(e->data, e->size);
+        e->loaded = EINA_TRUE;
+        return;
+     }
+
+   _edje_pick_budget_take(es->budget, e->size);
+   e->data = e->copy = eet_read(es->ef, e->name, &e->size);
+   if (e->data)
+     {
+        e->hash = _edje_pick_hash(e->data, e->size);
+        e->loaded = EINA_TRUE;
+     }
+
+   if (es->budget)
+     {  /* Only the hash is kept, _edje_pick_entry_same() reads it again */
+        free(e->copy);
+        e->data = e->copy = NULL;
+     }
+
+   _edje_pick_budget_release(es->budget, e->size);
+}
+
+static void
+_edje_pick_entries_get(Edje_Pick_Entries *es, Eet_File *ef,
+      const char *glob, unsigned int jobs, Edje_Pick_Budget *budget)
+{  /* Load real (non-alias) entries matching glob, in name order */
+   char **names;
+   int i, n = 0;
+
+   memset(es, 0, sizeof(*es));
+   es->ef = ef;
+   es->budget = budget;
+   names = eet_list(ef, glob, &n);
+   if (!names)
+     return;
+
+   es->e = calloc(n, sizeof(Edje_Pick_Entry));
+   for (i = 0; i < n; i++)
+     if (!_edje_pick_entry_is_alias(ef, names[i]))
+       es->e[es->count++].name = names[i];
+
+   free(names);
+   qsort(es->e, es->count, sizeof(Edje_Pick_Entry), _edje_pick_entry_cmp);
+   _edje_pick_jobs_run(jobs, es->count, _edje_pick_entry_load, es);
+}
+
+static void
+_edje_pick_entries_free(Edje_Pick_Entries *es)
+{
+   unsigned int i;
+
+   for (i = 0; i < es->count; i++)
+     free(es->e[i].copy);
+
+   free(es->e);
+   memset(es, 0, sizeof(*es));
+}
+
+static Eina_Bool
+_edje_pick_entry_same(Edje_Pick_Entries *es, const Edje_Pick_Entry *a,
+      const Edje_Pick_Entry *b)
+{  /* Compare payloads, reading again the ones dropped by the budget */
+   const void *da = a->data, *db = b->data;
+   void *ca = NULL, *cb = NULL;
+   unsigned long long held;
+   Eina_Bool ret;
+   int size;
+
+   if (a->size != b->size)
+     return EINA_FALSE;
+
+   held = (da ? 0 : a->size) + (db ? 0 : b->size);
+   _edje_pick_budget_take(es->budget, held);
+   if (!da)
+     da = ca = eet_read(es->ef, a->name, &size);
+
+   if (!db)
+     db = cb = eet_read(es->ef, b->name, &size);
+
+   ret = (da && db && !memcmp(da, db, a->size));
+   free(ca);
+   free(cb);
+   _edje_pick_budget_release(es->budget, held);
+   return ret;
+}
+
+static unsigned int
+_edje_pick_dedup_entries(Edje_Pick_Entries *es, unsigned long long *saved)
+{  /* Alias every entry to the first one (by name) with the same payload */
+   Edje_Pick_Entry *e, *keep;
+   Eina_Hash *seen = eina_hash_int64_new(NULL);
+   unsigned int i, n = 0;
+
+   for (i = 0; i < es->count; i++)
+     {
+        e = &es->e[i];
+        if (!e->loaded)
+          continue;
+
+        keep = eina_hash_find(seen, &e->hash);
+        if (!keep)
+          {
+             eina_hash_add(seen, &e->hash, e);
+             continue;
+          }
+
+        if (!_edje_pick_entry_same(es, keep, e))
+          continue;  /* Hash collision, keep both */
+
+        if (eet_alias(es->ef, e->name, keep->name, EET_COMPRESSION_NONE))
+          {
+             *saved += e->size;
+             n++;
+          }
+     }
+
+   eina_hash_free(seen);
+   return n;
+}
+
+unsigned long long
+_edje_pick_dedup(Edje_Pick_Opts *o)
+{  /* Identical payloads stored once; the other ids become eet aliases,
+      so collections keep their ids and still resolve. Returns bytes saved */
+   static const char *globs[] = {
+        EDJE_PICK_IMAGES_GLOB, EDJE_PICK_SAMPLES_GLOB, EDJE_PICK_FONTS_GLOB
+   };
+   unsigned long long saved = 0;
+   unsigned int i, n = 0, total = 0;
+   Edje_Pick_Entries es;
+   Eet_File *ef;
+
+   ef = eet_open(o->output, EET_FILE_MODE_READ_WRITE);
+   if (!ef)
+     return 0;
+
+   for (i = 0; i < EINA_C_ARRAY_LENGTH(globs); i++)
+     {
+        _edje_pick_entries_get(&es, ef, globs[i], o->jobs, o->budget);
+        n += _edje_pick_dedup_entries(&es, &saved);
+        total += es.count;
+        _edje_pick_entries_free(&es);
+     }
+
+   _edje_pick_output_close(o, ef);
+   _edje_pick_report(o,
+         "Dedup: %u of %u resources aliased, %llu bytes saved\n",
+         n, total, saved);
+
+   return saved;
+}
+
+static int
+_edje_pick_image_cmp(const void *d1, const void *d2)
+{
+   return strcmp(((const Edje_Pick_Image *) d1)->name,
+         ((const Edje_Pick_Image *) d2)->name);
+}
+
+static void
+_edje_pick_image_encode(void *data, unsigned int idx)
+{  /* Worker: decode one image and encode it with the recompress settings */
+   Edje_Pick_Images *is = data;
+   Edje_Pick_Image *im = &is->img[idx];
+   Edje_Pick_Opts *o = is->o;
+   const void *cur;
+   void *copy = NULL;
+   void *pixels;
+   unsigned int w, h;
+   int alpha, compress, quality;
+   Eet_Image_Encoding lossy, cur_lossy;
+   unsigned long long held = 0;
+
+   cur = eet_read_direct(is->ef, im->name, &im->old_size);
+   if (!cur)
+     cur = copy = eet_read(is->ef, im->name, &im->old_size);
+
+   if ((!cur) || !eet_data_image_header_decode(cur, im->old_size, &w, &h,
+            &alpha, &compress, &quality, &lossy))
+     goto end;
+
+   if (o->lossy_min)
+     lossy = (((unsigned long long) w * h) >= o->lossy_min) ?
+        EET_IMAGE_JPEG : EET_IMAGE_LOSSLESS;
+   else if ((lossy != EET_IMAGE_LOSSLESS) &&
+         (lossy != EET_IMAGE_JPEG))
+     goto end;  /* GPU formats are left as they are */
+
+   held = (unsigned long long) w * h * 4;
+   _edje_pick_budget_take(o->budget, held);
+   pixels = eet_data_image_decode(cur, im->old_size, &w, &h,
+         &alpha, &compress, &quality, &cur_lossy);
+   if (pixels && alpha && o->opaque &&
+       edje_pick_alpha_opaque(pixels, (size_t) w * h))
+     {
+        alpha = 0;
+        im->opaque = EINA_TRUE;
+     }
+
+   if (pixels)
+     {
+        im->data = eet_data_image_encode(pixels, &im->size, w, h, alpha,
+              o->image_compress, o->image_quality, lossy);
+        free(pixels);
+     }
+
+   _edje_pick_budget_release(o->budget, held);
+   if (im->data && (!im->opaque) && (im->size >= im->old_size))
+     {  /* Not worth it */
+        free(im->data);
+        im->data = NULL;
+     }
+
+   im->lossy = lossy;  /* Lossy ones carry their quality there too */
+   im->recoded = im->data &&
+      ((lossy != cur_lossy) || (lossy == EET_IMAGE_JPEG));
+
+end:
+   free(copy);
+}
+
+static void
+_edje_pick_recompress_describe(Edje_Pick_Opts *o, const Edje_Pick_Images *is)
+{  /* Images that went lossy or lossless must be described so in
+      edje/file, edje picks the loader and edje_edit the export by it */
+   Edje_Pick_Edit *ed;
+   const char *id;
+   unsigned int i;
+
+   ed = edje_pick_edit_open(o->output);
+   if (!ed)
+     {
+        EINA_LOG_ERR("Failed to describe encodings in '%s'", o->output);
+        return;
+     }
+
+   for (i = 0; i < is->count; i++)
+     {
+        const Edje_Pick_Image *im = &is->img[i];
+        if (!im->recoded)
+          continue;
+
+        id = strrchr(im->name, '/');
+        if ((!id) || (!edje_pick_edit_image_encoding_set(ed, atoi(id + 1),
+                    im->lossy == EET_IMAGE_JPEG, o->image_compress,
+                    o->image_quality)))
+          EINA_LOG_ERR("Failed to describe encoding of '%s'", im->name);
+     }
+
+   if (!edje_pick_edit_close(ed))
+     EINA_LOG_ERR("Failed to write '%s' of '%s'", EDJE_PICK_FILE_ENTRY,
+           o->output);
+}
+
+unsigned long long
+_edje_pick_recompress(Edje_Pick_Opts *o, unsigned int *count)
+{  /* Encode output images again across the worker pool, then write the
+      smaller ones from this thread in name order. Returns bytes saved */
+   unsigned long long saved = 0;
+   Edje_Pick_Images is;
+   char **names;
+   unsigned int i, recoded = 0;
+   int n = 0;
+
+   *count = 0;
+   is.ef = eet_open(o->output, EET_FILE_MODE_READ_WRITE);
+   if (!is.ef)
+     return 0;
+
+   is.o = o;
+   is.count = 0;
+   names = eet_list(is.ef, EDJE_PICK_IMAGES_GLOB, &n);
+   is.img = calloc(n ? n : 1, sizeof(Edje_Pick_Image));
+   for (i = 0; i < (unsigned int) n; i++)
+     if (!_edje_pick_entry_is_alias(is.ef, names[i]))
+       is.img[is.count++].name = names[i];
+
+   qsort(is.img, is.count, sizeof(Edje_Pick_Image), _edje_pick_image_cmp);
+   _edje_pick_jobs_run(o->jobs, is.count, _edje_pick_image_encode, &is);
+
+   for (i = 0; i < is.count; i++)
+     {
+        Edje_Pick_Image *im = &is.img[i];
+        if (!im->data)
+          continue;
+
+        if (eet_write(is.ef, im->name, im->data, im->size,
+                 EET_COMPRESSION_NONE) > 0)
+          {
+             if (im->size < im->old_size)  /* Not when only alpha went */
+               saved += im->old_size - im->size;
+
+             (*count)++;
+          }
+        else
+          im->recoded = EINA_FALSE;
+
+        free(im->data);
+        if (im->recoded)
+          recoded++;
+     }
+
+   _edje_pick_output_close(o, is.ef);
+   if (recoded)
+     _edje_pick_recompress_describe(o, &is);
+
+   free(is.img);
+   free(names);
+   _edje_pick_report(o,
+         "Recompress: %u of %u images encoded again, %llu bytes saved\n",
+         *count, is.count, saved);
+
+   return saved;
+}
+
+static void
+_edje_pick_image_opaque(void *data, unsigned int idx)
+{  /* Worker: encode one lossless image again without alpha if all its
+      pixels are opaque. Same level, so pixels are kept exactly */
+   Edje_Pick_Images *is = data;
+   Edje_Pick_Image *im = &is->img[idx];
+   Edje_Pick_Opts *o = is->o;
+   const void *cur;
+   void *copy = NULL;
+   void *pixels;
+   unsigned int w, h;
+   int alpha, compress, quality;
+   Eet_Image_Encoding lossy;
+   unsigned long long held;
+
+   cur = eet_read_direct(is->ef, im->name, &im->old_size);
+   if (!cur)
+     cur = copy = eet_read(is->ef, im->name, &im->old_size);
+
+   if ((!cur) || !eet_data_image_header_decode(cur, im->old_size, &w, &h,
+            &alpha, &compress, &quality, &lossy))
+     goto end;
+
+   /* Lossy ones would lose quality, --recompress handles them */
+   if ((!alpha) || (lossy != EET_IMAGE_LOSSLESS))
+     goto end;
+
+   held = (unsigned long long) w * h * 4;
+   _edje_pick_budget_take(o->budget, held);
+   pixels = eet_data_image_decode(cur, im->old_size, &w, &h,
+         &alpha, &compress, &quality, &lossy);
+   if (pixels && edje_pick_alpha_opaque(pixels, (size_t) w * h))
+     im->data = eet_data_image_encode(pixels, &im->size, w, h, 0,
+           compress, quality, EET_IMAGE_LOSSLESS);
+
+   free(pixels);
+   _edje_pick_budget_release(o->budget, held);
+
+end:
+   free(copy);
+}
+
+unsigned int
+_edje_pick_opaque(Edje_Pick_Opts *o)
+{  /* Scan output images with alpha across the worker pool, then write
+      the opaque ones from this thread in name order, so evas takes the
+      opaque paths drawing them. Returns the number written */
+   Edje_Pick_Images is;
+   char **names;
+   unsigned int i, count = 0;
+   int n = 0;
+
+   is.ef = eet_open(o->output, EET_FILE_MODE_READ_WRITE);
+   if (!is.ef)
+     return 0;
+
+   is.o = o;
+   is.count = 0;
+   names = eet_list(is.ef, EDJE_PICK_IMAGES_GLOB, &n);
+   is.img = calloc(n ? n : 1, sizeof(Edje_Pick_Image));
+   for (i = 0; i < (unsigned int) n; i++)
+     if (!_edje_pick_entry_is_alias(is.ef, names[i]))
+       is.img[is.count++].name = names[i];
+
+   qsort(is.img, is.count, sizeof(Edje_Pick_Image), _edje_pick_image_cmp);
+   _edje_pick_jobs_run(o->jobs, is.count, _edje_pick_image_opaque, &is);
+
+   for (i = 0; i < is.count; i++)
+     {
+        Edje_Pick_Image *im = &is.img[i];
+        if (!im->data)
+          continue;
+
+        if (eet_write(is.ef, im->name, im->data, im->size,
+                 EET_COMPRESSION_NONE) > 0)
+          count++;
+
+        free(im->data);
+     }
+
+   _edje_pick_output_close(o, is.ef);
+   free(is.img);
+   free(names);
+   _edje_pick_report(o, "Opaque: %u of %u images stored without alpha\n",
+         count, is.count);
+
+   return count;
+}
+
+static void
+_edje_pick_variants_make(void *data, unsigned int idx)
+{  /* Worker: decode one image and resample it at each scale. Variant
+      sizes come from the header, so the budget for the image and all
+      its variants is taken at once and released when they are made:
+      a worker never waits holding budget. Variants kept for the store
+      are not charged. */
+   Edje_Pick_Scales *sc = data;
+   Edje_Pick_Opts *o = sc->o;
+   Edje_Pick_Variant *v = &sc->v[idx * o->scales_count];
+   Eina_Bool make[EDJE_PICK_SCALES_MAX];
+   const void *cur;
+   void *copy = NULL;
+   unsigned int *pixels;
+   unsigned int w, h, i, pw = 0, ph = 0;
+   int size, alpha, compress, quality;
+   Eet_Image_Encoding lossy;
+   unsigned long long held;
+
+   cur = eet_read_direct(sc->ef, sc->entries[idx], &size);
+   if (!cur)
+     cur = copy = eet_read(sc->ef, sc->entries[idx], &size);
+
+   if ((!cur) || !eet_data_image_header_decode(cur, size, &w, &h,
+            &alpha, &compress, &quality, &lossy))
+     goto end;
+
+   if ((lossy != EET_IMAGE_LOSSLESS) && (lossy != EET_IMAGE_JPEG))
+     goto end;  /* GPU formats can't be resampled here */
+
+   held = (unsigned long long) w * h * 4;
+   for (i = 0; i < o->scales_count; i++)
+     {
+        v[i].ow = w;
+        v[i].oh = h;
+        v[i].alpha = alpha;
+        v[i].w = (unsigned int) ((w * v[i].scale) + 0.5);
+        v[i].h = (unsigned int) ((h * v[i].scale) + 0.5);
+        if (!v[i].w)
+          v[i].w = 1;
+
+        if (!v[i].h)
+          v[i].h = 1;
+
+        /* Not smaller, or the same as the previous scale gave */
+        make[i] = !(((v[i].w == w) && (v[i].h == h)) ||
+              ((v[i].w == pw) && (v[i].h == ph)));
+        if (!make[i])
+          continue;
+
+        pw = v[i].w;
+        ph = v[i].h;
+        held += (unsigned long long) v[i].w * v[i].h * 4;
+     }
+
+   _edje_pick_budget_take(o->budget, held);
+   pixels = eet_data_image_decode(cur, size, &w, &h,
+         &alpha, &compress, &quality, &lossy);
+   for (i = 0; pixels && (i < o->scales_count); i++)
+     {
+        if (!make[i])
+          continue;
+
+        v[i].pixels = malloc((size_t) v[i].w * v[i].h *
+              sizeof(unsigned int));
+        if (!v[i].pixels)
+          continue;  /* Left without this variant */
+
+        if (!edje_pick_resample(pixels, w, h, v[i].pixels, v[i].w, v[i].h))
+          {
+             free(v[i].pixels);
+             v[i].pixels = NULL;
+          }
+     }
+
+   free(pixels);
+   _edje_pick_budget_release(o->budget, held);
+
+end:
+   free(copy);
+}
+
+unsigned int
+_edje_pick_scale(Edje_Pick_Opts *o)
+{  /* Resample output images across the worker pool, then add the
+      variants with edje_edit from this thread, which rewrites the file.
+      Returns the number of images given variants */
+   Eina_List *grp = NULL, *img = NULL, *smp = NULL, *fnt = NULL;
+   Eina_List *l;
+   image_info_ex *ex;
+   Edje_Pick_Scales sc;
+   unsigned int i, n = 0, made = 0, per = o->scales_count;
+   char entry[PATH_MAX];
+
+   if (edje_pick_file_info_read(o->output, &grp, &img, &smp, &fnt) !=
+         EDJE_PICK_NO_ERROR)
+     goto end;
+
+   sc.ef = eet_open(o->output, EET_FILE_MODE_READ);
+   if (!sc.ef)
+     goto end;
+
+   sc.o = o;
+   sc.count = 0;
+   sc.entries = calloc(eina_list_count(img) + 1, sizeof(const char *));
+   sc.v = calloc((eina_list_count(img) + 1) * per, sizeof(Edje_Pick_Variant));
+   if ((!sc.entries) || (!sc.v))
+     {
+        free(sc.entries);
+        free(sc.v);
+        eet_close(sc.ef);
+        goto end;
+     }
+
+   EINA_LIST_FOREACH(img, l, ex)
+     {
+        snprintf(entry, sizeof(entry), EDJE_PICK_IMAGE_ENTRY, ex->id);
+        sc.entries[sc.count] = eina_stringshare_add(entry);
+        for (i = 0; i < per; i++)
+          {
+             sc.v[(sc.count * per) + i].image = ex->name;
+             sc.v[(sc.count * per) + i].scale = o->scales[i];
+          }
+
+        sc.count++;
+     }
+
+   _edje_pick_jobs_run(o->jobs, sc.count, _edje_pick_variants_make, &sc);
+   eet_close(sc.ef);
+
+   /* Keep the variants made, those of an image stay next to each other */
+   for (i = 0; i < sc.count * per; i++)
+     if (sc.v[i].pixels)
+       sc.v[n++] = sc.v[i];
+
+   if (n)
+     {
+        edje_init();
+        made = edje_pick_variants_store(o->output, sc.v, n);
+        edje_shutdown();
+     }
+
+   for (i = 0; i < n; i++)
+     free(sc.v[i].pixels);
+
+   for (i = 0; i < sc.count; i++)
+     eina_stringshare_del(sc.entries[i]);
+
+   free(sc.entries);
+   free(sc.v);
+   _edje_pick_report(o, "Scales: %u of %u images given %u variants\n",
+         made, sc.count, n);
+
+end:
+   _edje_pick_info_free(grp, img, smp, fnt);
+   return made;
+}
+
+static int
+_edje_pick_name_cmp(const void *d1, const void *d2)
+{
+   return strcmp(*(char * const *) d1, *(char * const *) d2);
+}
+
+static Eina_Bool
+_edje_pick_canonical_is_data(const char *name)
+{  /* Resources are plain data, everything else edje stores through
+      data descriptors */
+   return (fnmatch(EDJE_PICK_IMAGES_GLOB, name, 0) &&
+         fnmatch(EDJE_PICK_SAMPLES_GLOB, name, 0) &&
+         fnmatch(EDJE_PICK_FONTS_GLOB, name, 0));
+}
+
+static void
+_edje_pick_canonical_dump(void *data, const char *str)
+{
+   eina_strbuf_append(data, str);
+}
+
+static Eina_Bool
+_edje_pick_canonical_copy(Eet_File *in, Eet_File *out, const char *name)
+{  /* Copy one entry as stored, aliases stay aliases */
+   Eina_Strbuf *buf;
+   const char *alias;
+   const void *data;
+   void *copy;
+   int size;
+   Eina_Bool ret;
+
+   alias = eet_alias_get(in, name);
+   if (alias)
+     {
+        ret = eet_alias(out, name, alias, EET_COMPRESSION_NONE);
+        eina_stringshare_del(alias);
+        return ret;
+     }
+
+   data = eet_read_direct(in, name, &size);
+   if (_edje_pick_canonical_is_data(name))
+     {  /* Strings of data entries point in the file dictionary, which
+           the merge filled in its own order: encode them again */
+        buf = eina_strbuf_new();
+        if (eet_data_dump(in, name, _edje_pick_canonical_dump, buf))
+          {
+             ret = eet_data_undump(out, name, eina_strbuf_string_get(buf),
+                   eina_strbuf_length_get(buf), data ? EET_COMPRESSION_NONE :
+                   EET_COMPRESSION_DEFAULT);
+             eina_strbuf_free(buf);
+             return ret;
+          }
+
+        eina_strbuf_free(buf);
+     }
+
+   if (data)
+     return (eet_write(out, name, data, size, EET_COMPRESSION_NONE) > 0);
+
+   copy = eet_read(in, name, &size);  /* Was compressed, keep it so */
+   if (!copy)
+     return EINA_FALSE;
+
+   ret = (eet_write(out, name, copy, size, EET_COMPRESSION_DEFAULT) > 0);
+   free(copy);
+   return ret;
+}
+
+Eina_Bool
+_edje_pick_canonical(Edje_Pick_Opts *o)
+{  /* Rewrite output adding entries in name order. eet lays entries out
+      by name hash, then by insertion order within a bucket, so this makes
+      the file a function of its entries alone, whatever order the merge
+      and the parallel passes produced them in. */
+   const char *epoch = getenv(EDJE_PICK_SOURCE_DATE_ENV);
+   Eet_File *in, *out;
+   Eina_Bool ret = EINA_TRUE;
+   struct utimbuf ut;
+   char tmp[PATH_MAX];
+   char **names;
+   int i, n = 0;
+
+   snprintf(tmp, sizeof(tmp), "%s.canonical", o->output);
+   in = eet_open(o->output, EET_FILE_MODE_READ);
+   if (!in)
+     return EINA_FALSE;
+
+   out = eet_open(tmp, EET_FILE_MODE_WRITE);
+   if (!out)
+     {
+        eet_close(in);
+        return EINA_FALSE;
+     }
+
+   names = eet_list(in, "*", &n);
+   if (names)
+     qsort(names, n, sizeof(char *), _edje_pick_name_cmp);
+
+   for (i = 0; (i < n) && ret; i++)
+     ret = _edje_pick_canonical_copy(in, out, names[i]);
+
+   if (ret)  /* Sorts after every edje entry */
+     _edje_pick_state_add(o, out);
+
+   free(names);
+   eet_close(in);
+   if ((eet_close(out) != EET_ERROR_NONE) || (!ret) ||
+         (rename(tmp, o->output) < 0))
+     {
+        EINA_LOG_ERR("Failed to write '%s' in canonical order\n",
+              o->output);
+        unlink(tmp);
+        return EINA_FALSE;
+     }
+
+   if (epoch && *epoch)
+     {
+        ut.actime = ut.modtime = strtoll(epoch, NULL, 10);
+        utime(o->output, &ut);
+     }
+
+   return EINA_TRUE;
+}
+
+typedef struct _Edje_Pick_Collection Edje_Pick_Collection;
+struct _Edje_Pick_Collection
+{  /* What --trace-report decodes of a collection directory entry */
+   const char *entry;
+   int id;
+};
+
+typedef struct _Edje_Pick_Collections Edje_Pick_Collections;
+struct _Edje_Pick_Collections
+{  /* What --trace-report decodes of edje/file */
+   Eina_Hash *collection;
+};
+
+typedef struct _Edje_Pick_Trace Edje_Pick_Trace;
+struct _Edje_Pick_Trace
+{
+   Eet_File *ef;
+   Eina_Hash *layout;     /* Entry name to Edje_Pick_Extent */
+   Eina_Hash *entries;    /* "type name" to entry name, stringshare */
+   Eina_Hash *seen;       /* Entries already counted */
+   Eina_List *hits;       /* Edje_Pick_Extent of each traced entry */
+   unsigned long long bytes;
+   unsigned int lines;
+};
+
+static Eina_Bool
+_edje_pick_collections_entry(const Eina_Hash *hash EINA_UNUSED,
+      const void *key, void *data, void *fdata)
+{  /* Record where the collection is, then free what eet allocated */
+   Edje_Pick_Collection *c = data;
+   char buf[PATH_MAX];
+
+   snprintf(buf, sizeof(buf), "group %s", (const char *) key);
+   eina_hash_add(fdata, buf,
+         eina_stringshare_printf(EDJE_PICK_GROUP_ENTRY, c->id));
+   free(c);
+   return EINA_TRUE;
+}
+
+static void
+_edje_pick_collections_add(Eet_File *ef, Eina_Hash *entries)
+{  /* Decode only the collection directory of edje/file, eet skips the
+      fields our descriptors don't name */
+   Eet_Data_Descriptor_Class eddc;
+   Eet_Data_Descriptor *edd_file, *edd_coll;
+   Edje_Pick_Collections *file;
+
+   EET_EINA_FILE_DATA_DESCRIPTOR_CLASS_SET(&eddc, Edje_Pick_Collection);
+   eddc.name = "Edje_Part_Collection_Directory_Entry";
+   edd_coll = eet_data_descriptor_file_new(&eddc);
+   EET_DATA_DESCRIPTOR_ADD_BASIC(edd_coll, Edje_Pick_Collection,
+         "entry", entry, EET_T_STRING);
+   EET_DATA_DESCRIPTOR_ADD_BASIC(edd_coll, Edje_Pick_Collection,
+         "id", id, EET_T_INT);
+
+   EET_EINA_FILE_DATA_DESCRIPTOR_CLASS_SET(&eddc, Edje_Pick_Collections);
+   eddc.name = "Edje_File";
+   edd_file = eet_data_descriptor_file_new(&eddc);
+   EET_DATA_DESCRIPTOR_ADD_HASH(edd_file, Edje_Pick_Collections,
+         "collection", collection, edd_coll);
+
+   file = eet_data_read(ef, edd_file, EDJE_PICK_FILE_ENTRY);
+   if (file)
+     {
+        if (file->collection)
+          {
+             eina_hash_foreach(file->collection,
+                   _edje_pick_collections_entry, entries);
+             eina_hash_free(file->collection);
+          }
+
+        free(file);
+     }
+
+   eet_data_descriptor_free(edd_file);
+   eet_data_descriptor_free(edd_coll);
+}
+
+static void
+_edje_pick_trace_line(void *data, const char *line)
+{  /* Count the extent of the entry a trace line names, once */
+   Edje_Pick_Trace *t = data;
+   Edje_Pick_Extent *e;
+   const char *entry, *alias;
+
+   t->lines++;
+   entry = eina_hash_find(t->entries, line);
+   if (!entry)
+     entry = line;  /* Taken as an eet entry name */
+
+   alias = eet_alias_get(t->ef, entry);
+   e = eina_hash_find(t->layout, alias ? alias : entry);
+   if ((e) && (!eina_hash_find(t->seen, &e)))
+     {
+        eina_hash_add(t->seen, &e, e);
+        t->hits = eina_list_append(t->hits, e);
+        t->bytes += e->last - e->first + 1;
+     }
+
+   if (alias)
+     eina_stringshare_del(alias);
+}
+
+static int
+_edje_pick_extent_cmp(const void *d1, const void *d2)
+{
+   const Edje_Pick_Extent *a = d1;
+   const Edje_Pick_Extent *b = d2;
+
+   return (a->first < b->first) ? -1 : (a->first > b->first);
+}
+
+void
+_edje_pick_trace(const Edje_Pick_Opts *o, unsigned int *pages,
+      unsigned int *packed)
+{  /* Pages of the output the traced entries are on, and in how many
+      runs of consecutive pages, against the pages they would need laid
+      out one after the other */
+   Eina_List *grp = NULL, *img = NULL, *smp = NULL, *fnt = NULL;
+   Eina_List *l;
+   image_info_ex *ie;
+   sample_info_ex *se;
+   font_info_ex *fe;
+   Edje_Pick_Extent *e, *ext = NULL;
+   Edje_Pick_Trace t;
+   Eina_File *f;
+   void *map;
+   char buf[PATH_MAX];
+   long psize = sysconf(_SC_PAGESIZE);
+   unsigned int i, n = 0, runs = 0, last = 0;
+
+   *pages = *packed = 0;
+   memset(&t, 0, sizeof(t));
+   f = eina_file_open(o->output, EINA_FALSE);
+   if (!f)
+     return;
+
+   map = eina_file_map_all(f, EINA_FILE_RANDOM);
+   t.layout = map ? edje_pick_eet_layout(map, eina_file_size_get(f)) : NULL;
+   t.ef = t.layout ? eet_mmap(f) : NULL;
+   if ((!t.ef) || (psize <= 0) ||
+       (edje_pick_file_info_read(o->output, &grp, &img, &smp, &fnt) !=
+        EDJE_PICK_NO_ERROR))
+     {
+        EINA_LOG_ERR("Failed to read the layout of '%s'\n", o->output);
+        goto end;
+     }
+
+   t.entries = eina_hash_string_superfast_new(
+         EINA_FREE_CB(eina_stringshare_del));
+   t.seen = eina_hash_pointer_new(NULL);
+   _edje_pick_collections_add(t.ef, t.entries);
+   EINA_LIST_FOREACH(img, l, ie)
+     {
+        snprintf(buf, sizeof(buf), "image %s", ie->name);
+        eina_hash_add(t.entries, buf,
+              eina_stringshare_printf(EDJE_PICK_IMAGE_ENTRY, ie->id));
+     }
+
+   EINA_LIST_FOREACH(smp, l, se)
+     {
+        snprintf(buf, sizeof(buf), "sample %s", se->name);
+        eina_hash_add(t.entries, buf,
+              eina_stringshare_printf(EDJE_PICK_SAMPLE_ENTRY, se->id));
+     }
+
+   EINA_LIST_FOREACH(fnt, l, fe)
+     {
+        snprintf(buf, sizeof(buf), "font %s", fe->name);
+        eina_hash_add(t.entries, buf,
+              eina_stringshare_printf(EDJE_PICK_FONT_ENTRY, fe->name));
+     }
+
+   if (!_edje_pick_lines_read(o->trace, _edje_pick_trace_line, &t))
+     goto end;
+
+   n = eina_list_count(t.hits);
+   ext = malloc((n ? n : 1) * sizeof(Edje_Pick_Extent));
+   i = 0;
+   EINA_LIST_FREE(t.hits, e)
+     {  /* Page numbers from here on */
+        ext[i].first = e->first / psize;
+        ext[i].last = e->last / psize;
+        i++;
+     }
+
+   qsort(ext, n, sizeof(Edje_Pick_Extent), _edje_pick_extent_cmp);
+   for (i = 0; i < n; i++)
+     {  /* Overlapping or adjacent page ranges merge into one run */
+        if ((!runs) || (ext[i].first > last + 1))
+          {
+             runs++;
+             *pages += ext[i].last - ext[i].first + 1;
+             last = ext[i].last;
+          }
+        else if (ext[i].last > last)
+          {
+             *pages += ext[i].last - last;
+             last = ext[i].last;
+          }
+     }
+
+   *packed = (t.bytes + psize - 1) / psize;
+   _edje_pick_report(o, "Trace: %u of %u lines found, %llu bytes on %u "
+         "pages in %u runs; possible reduction if laid out together, not "
+         "applied: %u pages in 1 run\n",
+         n, t.lines, t.bytes, *pages, runs, *packed);
+
+end:
+   free(ext);
+   eina_list_free(t.hits);
+   if (t.seen)
+     eina_hash_free(t.seen);
+
+   if (t.entries)
+     eina_hash_free(t.entries);
+
+   if (t.ef)
+     eet_close(t.ef);
+
+   if (t.layout)
+     eina_hash_free(t.layout);
+
+   _edje_pick_info_free(grp, img, smp, fnt);
+   if (map)
+     eina_file_map_free(f, map);
+
+   eina_file_close(f);
+}
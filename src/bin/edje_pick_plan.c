@@ -0,0 +1,418 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Eina.h>
+
+#include "edje_pick_plan.h"
+#include "edje_pick_eet.h"
+
+typedef struct _Edje_Pick_Plan_File Edje_Pick_Plan_File;
+struct _Edje_Pick_Plan_File
+{  /* Cached info of one input */
+   const char *name;                /* stringshare */
+   Edje_Pick_Status status;         /* Of reading the info */
+   Eina_Hash *groups;               /* Set of its group names */
+   Eina_List *names;                /* Same names, stringshare, file order */
+   unsigned int groups_count;
+   unsigned long long groups_size;  /* Bytes not taken by resources */
+   unsigned long long res_size;     /* Bytes of images, samples, fonts */
+   Eina_Hash *sizes[EDJE_PICK_DEP_GROUP];  /* Resource name to its bytes */
+   Edje_Pick_Index *index;          /* Built on first query */
+   unsigned int taken;              /* Its groups in the selection */
+   Eina_List *taken_names;          /* Same groups, stringshare */
+   Eina_Bool reported;              /* Read failure already a conflict */
+};
+
+struct _Edje_Pick_Plan
+{
+   Eina_Hash *files;      /* Input name to Edje_Pick_Plan_File */
+   Eina_Hash *selected;   /* Group name to the file giving it */
+   Eina_List *conflicts;  /* Edje_Pick_Plan_Conflict */
+};
+
+static void
+_edje_pick_plan_file_free(void *data)
+{
+   Edje_Pick_Plan_File *pf = data;
+   const char *name;
+   unsigned int t;
+
+   EINA_LIST_FREE(pf->names, name)
+     eina_stringshare_del(name);
+
+   EINA_LIST_FREE(pf->taken_names, name)
+     eina_stringshare_del(name);
+
+   for (t = 0; t < EDJE_PICK_DEP_GROUP; t++)
+     if (pf->sizes[t])
+       eina_hash_free(pf->sizes[t]);
+
+   edje_pick_index_free(pf->index);
+   eina_hash_free(pf->groups);
+   eina_stringshare_del(pf->name);
+   free(pf);
+}
+
+static void
+_edje_pick_plan_size_add(Edje_Pick_Plan_File *pf, const Eina_Hash *layout,
+      Edje_Pick_Dep_Type type, const char *name, const char *entry)
+{  /* Record stored size of a resource entry, as the directory gives it */
+   const Edje_Pick_Extent *e = eina_hash_find(layout, entry);
+   unsigned long long *sz;
+
+   if ((!e) || eina_hash_find(pf->sizes[type], name))
+     return;
+
+   sz = malloc(sizeof(*sz));
+   if (!sz)
+     return;
+
+   *sz = e->last - e->first + 1;
+   eina_hash_add(pf->sizes[type], name, sz);
+   pf->res_size += *sz;
+}
+
+static void
+_edje_pick_plan_file_sizes_get(Edje_Pick_Plan_File *pf, Eina_List *img,
+      Eina_List *smp, Eina_List *fnt)
+{  /* What is not resources is groups, the directory and edje/file */
+   unsigned long long size;
+   image_info_ex *ie;
+   sample_info_ex *se;
+   font_info_ex *fe;
+   Eina_Hash *layout = NULL;
+   Eina_File *f;
+   Eina_List *l;
+   void *map;
+   char entry[256];
+   unsigned int t;
+
+   for (t = 0; t < EDJE_PICK_DEP_GROUP; t++)
+     pf->sizes[t] = eina_hash_string_superfast_new(free);
+
+   f = eina_file_open(pf->name, EINA_FALSE);
+   if (!f)
+     return;
+
+   /* Only the pages of the directory are read */
+   size = eina_file_size_get(f);
+   map = eina_file_map_all(f, EINA_FILE_RANDOM);
+   if (map)
+     layout = edje_pick_eet_layout(map, size);
+
+   if (layout)
+     {
+        EINA_LIST_FOREACH(img, l, ie)
+          {
+             snprintf(entry, sizeof(entry), EDJE_PICK_IMAGE_ENTRY, ie->id);
+             _edje_pick_plan_size_add(pf, layout, EDJE_PICK_DEP_IMAGE,
+                   ie->name, entry);
+          }
+
+        EINA_LIST_FOREACH(smp, l, se)
+          {
+             snprintf(entry, sizeof(entry), EDJE_PICK_SAMPLE_ENTRY, se->id);
+             _edje_pick_plan_size_add(pf, layout, EDJE_PICK_DEP_SAMPLE,
+                   se->name, entry);
+          }
+
+        EINA_LIST_FOREACH(fnt, l, fe)
+          {
+             snprintf(entry, sizeof(entry), EDJE_PICK_FONT_ENTRY, fe->name);
+             _edje_pick_plan_size_add(pf, layout, EDJE_PICK_DEP_FONT,
+                   fe->name, entry);
+          }
+
+        eina_hash_free(layout);
+     }
+
+   if (map)
+     eina_file_map_free(f, map);
+
+   pf->groups_size = (size > pf->res_size) ? (size - pf->res_size) : 0;
+   eina_file_close(f);
+}
+
+static Edje_Pick_Plan_File *
+_edje_pick_plan_file_get(Edje_Pick_Plan *p, const char *file)
+{  /* Cached info of file, read on first use */
+   Eina_List *grp = NULL, *img = NULL, *smp = NULL, *fnt = NULL;
+   Edje_Pick_Plan_File *pf;
+   const char *name;
+   Eina_List *l;
+   void *ex;
+
+   pf = eina_hash_find(p->files, file);
+   if (pf)
+     return pf;
+
+   pf = calloc(1, sizeof(Edje_Pick_Plan_File));
+   pf->name = eina_stringshare_add(file);
+   pf->groups = eina_hash_string_superfast_new(NULL);
+   pf->status = edje_pick_file_info_read(file, &grp, &img, &smp, &fnt);
+   if (pf->status == EDJE_PICK_NO_ERROR)
+     {
+        EINA_LIST_FOREACH(grp, l, name)
+          {
+             if (eina_hash_find(pf->groups, name))
+               continue;
+
+             eina_hash_add(pf->groups, name, pf);
+             pf->names = eina_list_append(pf->names,
+                   eina_stringshare_add(name));
+             pf->groups_count++;
+          }
+
+        _edje_pick_plan_file_sizes_get(pf, img, smp, fnt);
+     }
+
+   eina_list_free(grp);
+   EINA_LIST_FREE(img, ex)
+     free(ex);
+
+   EINA_LIST_FREE(smp, ex)
+     free(ex);
+
+   EINA_LIST_FREE(fnt, ex)
+     free(ex);
+
+   eina_hash_add(p->files, file, pf);
+   return pf;
+}
+
+static Edje_Pick_Status
+_edje_pick_plan_conflict_add(Edje_Pick_Plan *p, Edje_Pick_Status status,
+      const char *file, const char *group, const char *other)
+{
+   Edje_Pick_Plan_Conflict *c = calloc(1, sizeof(Edje_Pick_Plan_Conflict));
+
+   c->status = status;
+   c->file = eina_stringshare_add(file);
+   c->group = eina_stringshare_add(group);
+   c->other = eina_stringshare_add(other);
+   p->conflicts = eina_list_append(p->conflicts, c);
+   return status;
+}
+
+static Edje_Pick_Status
+_edje_pick_plan_take(Edje_Pick_Plan *p, Edje_Pick_Plan_File *pf,
+      const char *group)
+{
+   Edje_Pick_Plan_File *prev;
+
+   if (!eina_hash_find(pf->groups, group))
+     return _edje_pick_plan_conflict_add(p, EDJE_PICK_GROUP_MISSING,
+           pf->name, group, NULL);
+
+   prev = eina_hash_find(p->selected, group);
+   if (prev == pf)
+     return EDJE_PICK_NO_ERROR;  /* Same group given twice */
+
+   if (prev)
+     return _edje_pick_plan_conflict_add(p, EDJE_PICK_DUP_GROUP,
+           pf->name, group, prev->name);
+
+   eina_hash_add(p->selected, group, pf);
+   pf->taken++;
+   pf->taken_names = eina_list_append(pf->taken_names,
+         eina_stringshare_add(group));
+   return EDJE_PICK_NO_ERROR;
+}
+
+static Edje_Pick_Plan_File *
+_edje_pick_plan_file_check(Edje_Pick_Plan *p, const char *file)
+{  /* Info of file if it could be read, report it once otherwise */
+   Edje_Pick_Plan_File *pf = _edje_pick_plan_file_get(p, file);
+
+   if (pf->status == EDJE_PICK_NO_ERROR)
+     return pf;
+
+   if (!pf->reported)
+     _edje_pick_plan_conflict_add(p, pf->status, file, NULL, NULL);
+
+   pf->reported = EINA_TRUE;
+   return NULL;
+}
+
+Edje_Pick_Plan *
+edje_pick_plan_new(void)
+{
+   Edje_Pick_Plan *p = calloc(1, sizeof(Edje_Pick_Plan));
+
+   p->files = eina_hash_string_superfast_new(_edje_pick_plan_file_free);
+   p->selected = eina_hash_string_superfast_new(NULL);
+   return p;
+}
+
+static Eina_Bool
+_edje_pick_plan_file_reset(const Eina_Hash *hash EINA_UNUSED,
+      const void *key EINA_UNUSED, void *data, void *fdata EINA_UNUSED)
+{
+   Edje_Pick_Plan_File *pf = data;
+   const char *name;
+
+   EINA_LIST_FREE(pf->taken_names, name)
+     eina_stringshare_del(name);
+
+   pf->taken = 0;
+   pf->reported = EINA_FALSE;
+   return EINA_TRUE;
+}
+
+void
+edje_pick_plan_reset(Edje_Pick_Plan *p)
+{
+   Edje_Pick_Plan_Conflict *c;
+
+   EINA_LIST_FREE(p->conflicts, c)
+     {
+        eina_stringshare_del(c->file);
+        eina_stringshare_del(c->group);
+        eina_stringshare_del(c->other);
+        free(c);
+     }
+
+   eina_hash_free_buckets(p->selected);
+   eina_hash_foreach(p->files, _edje_pick_plan_file_reset, NULL);
+}
+
+void
+edje_pick_plan_free(Edje_Pick_Plan *p)
+{
+   if (!p)
+     return;
+
+   edje_pick_plan_reset(p);
+   eina_hash_free(p->selected);
+   eina_hash_free(p->files);
+   free(p);
+}
+
+void
+edje_pick_plan_file_forget(Edje_Pick_Plan *p, const char *file)
+{  /* Selection must not refer to it, so the plan is reset as well */
+   edje_pick_plan_reset(p);
+   eina_hash_del_by_key(p->files, file);
+}
+
+Edje_Pick_Status
+edje_pick_plan_group_add(Edje_Pick_Plan *p, const char *file,
+      const char *group)
+{
+   Edje_Pick_Plan_File *pf = _edje_pick_plan_file_check(p, file);
+
+   if (!pf)
+     return edje_pick_plan_status_get(p);
+
+   return _edje_pick_plan_take(p, pf, group);
+}
+
+Edje_Pick_Status
+edje_pick_plan_file_add(Edje_Pick_Plan *p, const char *file)
+{
+   Edje_Pick_Plan_File *pf = _edje_pick_plan_file_check(p, file);
+   Edje_Pick_Status status = EDJE_PICK_NO_ERROR;
+   Edje_Pick_Status s;
+   const char *name;
+   Eina_List *l;
+
+   if (!pf)
+     return edje_pick_plan_status_get(p);
+
+   EINA_LIST_FOREACH(pf->names, l, name)
+     {  /* Go on after a conflict so all of them are listed */
+        s = _edje_pick_plan_take(p, pf, name);
+        if (status == EDJE_PICK_NO_ERROR)
+          status = s;
+     }
+
+   return status;
+}
+
+const Eina_List *
+edje_pick_plan_conflicts_get(const Edje_Pick_Plan *p)
+{
+   return p->conflicts;
+}
+
+Edje_Pick_Status
+edje_pick_plan_status_get(const Edje_Pick_Plan *p)
+{
+   Edje_Pick_Plan_Conflict *c = eina_list_data_get(p->conflicts);
+
+   return c ? c->status : EDJE_PICK_NO_ERROR;
+}
+
+static Eina_Bool
+_edje_pick_plan_res_size_add(const Eina_Hash *hash EINA_UNUSED,
+      const void *key, void *data EINA_UNUSED, void *fdata)
+{
+   void **ctx = fdata;  /* Sizes by name, then the sum */
+   unsigned long long *sz = eina_hash_find(ctx[0], key);
+
+   if (sz)
+     *((unsigned long long *) ctx[1]) += *sz;
+
+   return EINA_TRUE;
+}
+
+static unsigned long long
+_edje_pick_plan_file_res_size(const Edje_Pick_Plan_File *pf)
+{  /* With an index, only resources reachable from taken groups count */
+   unsigned long long size = 0;
+   void *ctx[2];
+   Eina_Hash *set;
+   unsigned int t;
+
+   if (!pf->index)
+     return pf->res_size;
+
+   ctx[1] = &size;
+   for (t = 0; t < EDJE_PICK_DEP_GROUP; t++)
+     {
+        set = edje_pick_index_reachable_get(pf->index, pf->taken_names, t);
+        ctx[0] = pf->sizes[t];
+        eina_hash_foreach(set, _edje_pick_plan_res_size_add, ctx);
+        eina_hash_free(set);
+     }
+
+   return size;
+}
+
+static Eina_Bool
+_edje_pick_plan_file_size_add(const Eina_Hash *hash EINA_UNUSED,
+      const void *key EINA_UNUSED, void *data, void *fdata)
+{
+   Edje_Pick_Plan_File *pf = data;
+   unsigned long long *size = fdata;
+
+   if (pf->taken)
+     *size += _edje_pick_plan_file_res_size(pf) +
+        ((pf->groups_size * pf->taken) / pf->groups_count);
+
+   return EINA_TRUE;
+}
+
+unsigned long long
+edje_pick_plan_size_estimate(const Edje_Pick_Plan *p)
+{
+   unsigned long long size = 0;
+
+   eina_hash_foreach(p->files, _edje_pick_plan_file_size_add, &size);
+   return size;
+}
+
+const Edje_Pick_Index *
+edje_pick_plan_index_get(Edje_Pick_Plan *p, const char *file)
+{
+   Edje_Pick_Plan_File *pf = _edje_pick_plan_file_get(p, file);
+
+   if ((!pf->index) && (pf->status == EDJE_PICK_NO_ERROR))
+     pf->index = edje_pick_index_new(file);
+
+   return pf->index;
+}
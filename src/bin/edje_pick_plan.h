@@ -0,0 +1,56 @@
+#ifndef EDJE_PICK_PLAN_H
+#define EDJE_PICK_PLAN_H
+
+#include <Eina.h>
+#include "Edje_Pick.h"
+#include "edje_pick_index.h"
+
+/* Pick plan: checks a selection of groups for conflicts in memory and
+   estimates the output size, without building anything.
+   File info is read once per input and cached in the plan, so checking
+   a changed selection again does not touch the filesystem. */
+
+typedef struct _Edje_Pick_Plan Edje_Pick_Plan;
+
+typedef struct _Edje_Pick_Plan_Conflict Edje_Pick_Plan_Conflict;
+struct _Edje_Pick_Plan_Conflict
+{
+   Edje_Pick_Status status;   /* What edje_pick_process() would fail with */
+   const char *file;          /* stringshare, input the conflict is in */
+   const char *group;         /* stringshare, NULL if about the file */
+   const char *other;         /* stringshare, input already giving group */
+};
+
+Edje_Pick_Plan *edje_pick_plan_new(void);
+void edje_pick_plan_free(Edje_Pick_Plan *p);
+
+/* Drop the selection and conflicts, keep cached file info */
+void edje_pick_plan_reset(Edje_Pick_Plan *p);
+
+/* Forget cached info of file, call when it was rewritten */
+void edje_pick_plan_file_forget(Edje_Pick_Plan *p, const char *file);
+
+/* Select group of file (-i file -g group), or all its groups (-a file).
+   Return the status of this addition, conflicts are also recorded. */
+Edje_Pick_Status edje_pick_plan_group_add(Edje_Pick_Plan *p,
+      const char *file, const char *group);
+Edje_Pick_Status edje_pick_plan_file_add(Edje_Pick_Plan *p, const char *file);
+
+/* List of Edje_Pick_Plan_Conflict, in the order found */
+const Eina_List *edje_pick_plan_conflicts_get(const Edje_Pick_Plan *p);
+
+/* Status of the first conflict, EDJE_PICK_NO_ERROR if none */
+Edje_Pick_Status edje_pick_plan_status_get(const Edje_Pick_Plan *p);
+
+/* Estimated output size in bytes. Group sizes are apportioned from the
+   input layout. Resources count in full once any group of their input
+   is selected, unless the input was indexed: then only the ones the
+   selected groups reach count. */
+unsigned long long edje_pick_plan_size_estimate(const Edje_Pick_Plan *p);
+
+/* Dependency index of file, built on first call and kept with the
+   cached file info. NULL if file can't be read. */
+const Edje_Pick_Index *edje_pick_plan_index_get(Edje_Pick_Plan *p,
+      const char *file);
+
+#endif
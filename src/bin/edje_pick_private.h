@@ -0,0 +1,233 @@
+#ifndef EDJE_PICK_PRIVATE_H
+#define EDJE_PICK_PRIVATE_H
+
+#include <Eina.h>
+#include <Eet.h>
+#include "Edje_Pick.h"
+
+/* Driver state shared by edje_pick.c and the units it runs */
+
+/* Driver options, stripped before argv goes to edje_pick_process() */
+#define EDJE_PICK_OPT_JOBS "--jobs"
+#define EDJE_PICK_OPT_MANIFEST "--manifest"
+#define EDJE_PICK_OPT_UP_TO_DATE "--skip-up-to-date"
+#define EDJE_PICK_OPT_DEDUP "--dedup"
+#define EDJE_PICK_OPT_DAEMON "--daemon"
+#define EDJE_PICK_OPT_CONNECT "--connect"
+#define EDJE_PICK_OPT_STATS "--stats"
+#define EDJE_PICK_OPT_MAX_MEM "--max-mem"
+#define EDJE_PICK_OPT_DRY_RUN "--dry-run"
+#define EDJE_PICK_OPT_RECOMPRESS "--recompress"
+#define EDJE_PICK_OPT_IMAGE_QUALITY "--image-quality"
+#define EDJE_PICK_OPT_IMAGE_COMPRESS "--image-compress"
+#define EDJE_PICK_OPT_LOSSY_MIN "--lossy-min"
+#define EDJE_PICK_OPT_REPRODUCIBLE "--reproducible"
+#define EDJE_PICK_OPT_WATCH "--watch"
+#define EDJE_PICK_OPT_CACHE "--cache"
+#define EDJE_PICK_OPT_GC "--gc"
+#define EDJE_PICK_OPT_GROUPS_FROM "--groups-from"
+#define EDJE_PICK_OPT_VERIFY "--verify"
+#define EDJE_PICK_OPT_SPLIT "--split"
+#define EDJE_PICK_OPT_SPLIT_DEPTH "--split-depth"
+#define EDJE_PICK_OPT_GROUP_REGEX "--group-regex"
+#define EDJE_PICK_OPT_SCALES "--scales"
+#define EDJE_PICK_OPT_OPAQUE "--opaque"
+#define EDJE_PICK_OPT_TRACE_REPORT "--trace-report"
+
+/* Daemon name used by clients when --connect is not given */
+#define EDJE_PICK_DAEMON_ENV "EDJE_PICK_DAEMON"
+
+/* Output mtime for --reproducible, as in reproducible-builds.org */
+#define EDJE_PICK_SOURCE_DATE_ENV "SOURCE_DATE_EPOCH"
+
+/* Most variants --scales makes of an image */
+#define EDJE_PICK_SCALES_MAX 4
+
+enum _Edje_Pick_Phase
+{  /* Timed phases, names in _edje_pick_phase_names */
+   EDJE_PICK_PHASE_PARSE,        /* Driver argument parsing */
+   EDJE_PICK_PHASE_OPEN,         /* Opening, mapping, hashing inputs */
+   EDJE_PICK_PHASE_MERGE,        /* edje_pick_process() */
+   EDJE_PICK_PHASE_GC,           /* Dropping unused resources */
+   EDJE_PICK_PHASE_SCALE,        /* Making image variants */
+   EDJE_PICK_PHASE_OPAQUE,       /* Dropping alpha of opaque images */
+   EDJE_PICK_PHASE_RECOMPRESS,   /* Encoding images again */
+   EDJE_PICK_PHASE_DEDUP,        /* Aliasing identical resources */
+   EDJE_PICK_PHASE_TRACE,        /* Mapping the trace onto output pages */
+   EDJE_PICK_PHASE_VERIFY,       /* Checking the output loads */
+   EDJE_PICK_PHASE_CANONICAL,    /* Rewriting in canonical order */
+   EDJE_PICK_PHASE_STATE,        /* State entry when no pass wrote it */
+   EDJE_PICK_PHASE_CACHE,        /* Storing outputs in the cache */
+   EDJE_PICK_PHASE_LAST
+};
+typedef enum _Edje_Pick_Phase Edje_Pick_Phase;
+
+typedef struct _Edje_Pick_Stats Edje_Pick_Stats;
+struct _Edje_Pick_Stats
+{  /* Accumulated over all outputs of one invocation */
+   double start;
+   double phase[EDJE_PICK_PHASE_LAST];  /* Seconds in each phase */
+   unsigned long long bytes_read;       /* Input bytes staged */
+   unsigned long long bytes_written;    /* Size of outputs built */
+   unsigned long long dedup_saved;      /* Bytes saved by --dedup */
+   unsigned long long recompress_saved; /* Bytes saved by --recompress */
+   unsigned long long gc_removed;       /* Bytes removed by --gc */
+   unsigned int inputs;
+   unsigned int outputs;                /* Outputs built */
+   unsigned int skipped;                /* Outputs found up to date */
+   unsigned int recompressed;           /* Images encoded again */
+   unsigned int collected;              /* Resources dropped by --gc */
+   unsigned int verified;               /* Resources checked by --verify */
+   unsigned int problems;               /* What --verify found wrong */
+   unsigned int scaled;                 /* Images given --scales variants */
+   unsigned int opaque;                 /* Images stored without alpha */
+   unsigned int trace_pages;            /* Pages the trace touches */
+   unsigned int trace_pages_packed;     /* Possible, if laid out together */
+   unsigned int cache_hits;             /* Outputs served from --cache */
+   unsigned int cache_misses;           /* Outputs built and cached */
+   unsigned int groups;                 /* Entries in built outputs */
+   unsigned int images;
+   unsigned int samples;
+   unsigned int fonts;
+};
+
+typedef struct _Edje_Pick_Input Edje_Pick_Input;
+struct _Edje_Pick_Input
+{  /* Input file as staged by the worker pool */
+   const char *name;   /* stringshare, as given with -i / -a */
+   Eina_File *f;       /* Kept open so eet reuses the same mapping */
+   void *map;
+   size_t size;
+   unsigned long long hash;   /* Content hash, valid when 'hashed' */
+   Eina_Bool hashed;
+};
+
+typedef struct _Edje_Pick_Budget Edje_Pick_Budget;
+struct _Edje_Pick_Budget
+{  /* Memory ceiling shared by workers, see _edje_pick_budget_take() */
+   unsigned long long max;
+   unsigned long long used;
+   Eina_Lock lock;
+   Eina_Condition cond;
+};
+
+typedef struct _Edje_Pick_Opts Edje_Pick_Opts;
+struct _Edje_Pick_Opts
+{
+   unsigned int jobs;         /* Worker threads, 0 means one per CPU */
+   const char *manifest;      /* Batch file, one output spec per line */
+   Eina_Bool up_to_date;      /* Skip build if output is up to date */
+   char *state;               /* State entry to add to the output, or NULL */
+   Eina_Bool dedup;           /* Alias resources with identical payload */
+   const char *daemon;        /* Serve requests on this local socket */
+   Eina_Bool stats_json;      /* --stats=json was given */
+   Edje_Pick_Stats *stats;    /* Where to account, NULL if not wanted */
+   unsigned long long max_mem;   /* --max-mem for the post-merge passes,
+                                    0 means unbounded */
+   Edje_Pick_Budget *budget;     /* Set when max_mem is, owned by exec */
+   Eina_Bool dry_run;         /* Only check and estimate */
+   Eina_Bool recompress;      /* Encode images again */
+   Eina_Bool opaque;          /* Drop alpha of opaque images */
+   unsigned int image_quality;   /* Lossy quality for recompress */
+   unsigned int image_compress;  /* Lossless level for recompress */
+   unsigned int lossy_min;    /* Pixels from which to go lossy, 0: keep */
+   Eina_Bool reproducible;    /* Canonical entry order, fixed mtime */
+   Eina_Bool watch;           /* Rebuild when inputs change */
+   const char *cache;         /* Output cache directory */
+   Eina_Bool gc;              /* Drop resources no group uses */
+   Eina_Bool groups_stdin;    /* --groups-from - was given */
+   Eina_Bool served;          /* Daemon request, stdin is not the client's */
+   Eina_Bool verify;          /* Check the output after building it */
+   const char *split;         /* Directory of per-group outputs */
+   unsigned int split_depth;  /* Name parts per split output, 0: all */
+   const char *trace;         /* --trace-report access trace */
+   double scales[EDJE_PICK_SCALES_MAX];   /* --scales, in given order */
+   unsigned int scales_count;
+   char **args;               /* argv with @FILE expanded, NULL if none */
+   Eina_List *strings;        /* stringshare read from lists, args use them */
+   Eina_Hash *listed;         /* Group names from lists to their input,
+                                 the names are in argv too */
+   Eina_List *patterns;       /* Edje_Pick_Pattern of the last -i input */
+   Edje_Pick_Input *inputs;   /* Distinct input files, in argv order */
+   unsigned int inputs_count;
+   const char *output;        /* Output file name given with -o */
+   int argc;                  /* What is left for edje_pick_process() */
+   char **argv;
+   unsigned int argv_size;    /* Allocated entries of argv */
+};
+
+typedef void (*Edje_Pick_Job_Cb)(void *data, unsigned int idx);
+
+typedef void (*Edje_Pick_Line_Cb)(void *data, const char *line);
+
+double _edje_pick_time_get(void);
+void _edje_pick_stats_phase_add(Edje_Pick_Stats *st, Edje_Pick_Phase ph,
+      double t0);
+void _edje_pick_stats_output_add(Edje_Pick_Stats *st, const char *output);
+
+/* Summary line of a pass, left out when --stats prints the counters */
+void _edje_pick_report(const Edje_Pick_Opts *o, const char *fmt, ...)
+   EINA_PRINTF(2, 3);
+
+/* Call func for each index in [0, count) on up to jobs threads */
+void _edje_pick_jobs_run(unsigned int jobs, unsigned int count,
+      Edje_Pick_Job_Cb func, void *data);
+
+/* Both are no-ops without a budget */
+void _edje_pick_budget_take(Edje_Pick_Budget *b, unsigned long long size);
+void _edje_pick_budget_release(Edje_Pick_Budget *b, unsigned long long size);
+
+unsigned long long _edje_pick_hash(const unsigned char *p, size_t size);
+
+/* Write the pending state entry of o, if any, to an output open to write.
+   _edje_pick_output_close() does it and closes ef. */
+void _edje_pick_state_add(Edje_Pick_Opts *o, Eet_File *ef);
+void _edje_pick_output_close(Edje_Pick_Opts *o, Eet_File *ef);
+
+/* Call func for each line of file, "-" for stdin */
+Eina_Bool _edje_pick_lines_read(const char *file, Edje_Pick_Line_Cb func,
+      void *data);
+
+/* One edje_pick invocation, from main() or from a daemon request */
+int _edje_pick_exec(int argc, char **argv, Eina_Bool served);
+
+/* Argument parsing, shared with the client forwarding argv */
+const char *_edje_pick_opt_value(const char *opt, int argc, char **argv,
+      int *i);
+Eina_Bool _edje_pick_lib_opt_valued(const char *arg);
+
+/* Prefetch the inputs of o on the worker pool, and let them go */
+void _edje_pick_inputs_stage(Edje_Pick_Opts *o);
+void _edje_pick_inputs_release(Edje_Pick_Opts *o);
+
+/* Build the output of o, its inputs staged */
+int _edje_pick_run(Edje_Pick_Opts *o);
+
+/* Write the groups selected in o to their own outputs under o->split.
+   In edje_pick_split.c. */
+int _edje_pick_split(Edje_Pick_Opts *o);
+
+/* Keep the outputs of targets, Edje_Pick_Opts, built until interrupted.
+   In edje_pick_watch.c. */
+int _edje_pick_watch(Eina_List *targets);
+
+/* Daemon and client, in edje_pick_daemon.c. The client returns the
+   daemon's status, or -1 when it could not be reached. */
+int _edje_pick_daemon_run(const char *name, const char *prog);
+const char *_edje_pick_client_server_get(int argc, char **argv);
+int _edje_pick_client_run(const char *server, int argc, char **argv);
+
+/* The passes after the merge, in edje_pick_passes.c, in the order
+   _edje_pick_run() calls them. Each works on o->output. */
+unsigned long long _edje_pick_gc(Edje_Pick_Opts *o, unsigned int *count);
+unsigned int _edje_pick_scale(Edje_Pick_Opts *o);
+unsigned int _edje_pick_opaque(Edje_Pick_Opts *o);
+unsigned long long _edje_pick_recompress(Edje_Pick_Opts *o,
+      unsigned int *count);
+unsigned long long _edje_pick_dedup(Edje_Pick_Opts *o);
+Eina_Bool _edje_pick_canonical(Edje_Pick_Opts *o);
+void _edje_pick_trace(const Edje_Pick_Opts *o, unsigned int *pages,
+      unsigned int *packed);
+unsigned int _edje_pick_verify(Edje_Pick_Opts *o, unsigned int *count);
+
+#endif
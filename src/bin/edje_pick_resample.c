@@ -0,0 +1,149 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "edje_pick_resample.h"
+
+/* Source pixels added per inner loop of the vertical pass */
+#define EDJE_PICK_RESAMPLE_BLOCK 16
+
+typedef struct _Edje_Pick_Span Edje_Pick_Span;
+struct _Edje_Pick_Span
+{  /* Source pixels covered by one output pixel along an axis */
+   unsigned int first;
+   unsigned int count;
+   float *w;            /* count weights, summing to 1 */
+};
+
+static Edje_Pick_Span *
+_edje_pick_spans_new(unsigned int n, unsigned int m, float **weights)
+{  /* Spans for scaling n source pixels to m, m <= n. An output pixel
+      covers n / m source pixels, so at most that plus 2 partial ones. */
+   Edje_Pick_Span *sp = malloc(m * sizeof(Edje_Pick_Span));
+   unsigned int per = (n / m) + 2;
+   float *w = malloc(m * per * sizeof(float));
+   double scale = (double) n / m;
+   double start, end, lo, hi;
+   unsigned int i, j;
+
+   if ((!sp) || (!w))
+     {
+        free(sp);
+        free(w);
+        return NULL;
+     }
+
+   for (i = 0; i < m; i++)
+     {
+        start = i * scale;
+        end = (i + 1) * scale;
+        sp[i].first = (unsigned int) start;
+        sp[i].count = 0;
+        sp[i].w = w + (i * per);
+        for (j = sp[i].first; (j < n) && (j < end); j++)
+          {
+             lo = (j > start) ? j : start;
+             hi = ((j + 1) < end) ? (j + 1) : end;
+             sp[i].w[sp[i].count++] = (float) ((hi - lo) / scale);
+          }
+     }
+
+   *weights = w;
+   return sp;
+}
+
+static void
+_edje_pick_row_add(const unsigned int *row, unsigned int w, float wk,
+      float *acc)
+{  /* Add a source row, weighted by wk, to acc as 4 channels per pixel.
+      Full blocks have a constant trip count so they are vectorized at
+      -O2 too, where GCC 12 doesn't version loops of unknown length */
+   const unsigned int *full = row + (w - (w % EDJE_PICK_RESAMPLE_BLOCK));
+   const unsigned int *end = row + w;
+   unsigned int k;
+
+   for (; row < full;
+         row += EDJE_PICK_RESAMPLE_BLOCK, acc += 4 * EDJE_PICK_RESAMPLE_BLOCK)
+     for (k = 0; k < EDJE_PICK_RESAMPLE_BLOCK; k++)
+       {
+          acc[(k * 4) + 0] += (int) ((row[k] >> 24) & 0xff) * wk;
+          acc[(k * 4) + 1] += (int) ((row[k] >> 16) & 0xff) * wk;
+          acc[(k * 4) + 2] += (int) ((row[k] >> 8) & 0xff) * wk;
+          acc[(k * 4) + 3] += (int) (row[k] & 0xff) * wk;
+       }
+
+   for (; row < end; row++, acc += 4)  /* Tail, less than a block */
+     {
+        acc[0] += (int) ((*row >> 24) & 0xff) * wk;
+        acc[1] += (int) ((*row >> 16) & 0xff) * wk;
+        acc[2] += (int) ((*row >> 8) & 0xff) * wk;
+        acc[3] += (int) (*row & 0xff) * wk;
+     }
+}
+
+static unsigned int
+_edje_pick_channel_pack(float v, unsigned int shift)
+{
+   v += 0.5f;
+   if (v > 255.0f)
+     v = 255.0f;
+
+   return ((unsigned int) v) << shift;
+}
+
+int
+edje_pick_resample(const unsigned int *src, unsigned int sw,
+      unsigned int sh, unsigned int *dst, unsigned int dw, unsigned int dh)
+{  /* Vertical pass into a float row of sw pixels, then horizontal */
+   Edje_Pick_Span *xs, *ys;
+   float *xw = NULL, *yw = NULL;
+   float *acc;
+   float sum[4];
+   const float *p;
+   unsigned int x, y, k, c, n = sw * 4;
+   int ret = 0;
+
+   xs = _edje_pick_spans_new(sw, dw, &xw);
+   ys = _edje_pick_spans_new(sh, dh, &yw);
+   acc = malloc(n * sizeof(float));
+   if ((!xs) || (!ys) || (!acc))
+     goto end;
+
+   for (y = 0; y < dh; y++)
+     {
+        for (c = 0; c < n; c++)
+          acc[c] = 0.0f;
+
+        for (k = 0; k < ys[y].count; k++)
+          _edje_pick_row_add(src + ((ys[y].first + k) * sw), sw,
+                ys[y].w[k], acc);
+
+        for (x = 0; x < dw; x++)
+          {  /* The k loop is vectorized across the 4 channels */
+             p = acc + (xs[x].first * 4);
+             for (c = 0; c < 4; c++)
+               sum[c] = 0.0f;
+
+             for (k = 0; k < xs[x].count; k++, p += 4)
+               for (c = 0; c < 4; c++)
+                 sum[c] += p[c] * xs[x].w[k];
+
+             dst[(y * dw) + x] = _edje_pick_channel_pack(sum[0], 24) |
+                _edje_pick_channel_pack(sum[1], 16) |
+                _edje_pick_channel_pack(sum[2], 8) |
+                _edje_pick_channel_pack(sum[3], 0);
+          }
+     }
+
+   ret = 1;
+
+end:
+   free(xs);
+   free(ys);
+   free(xw);
+   free(yw);
+   free(acc);
+   return ret;
+}
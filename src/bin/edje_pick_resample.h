@@ -0,0 +1,15 @@
+#ifndef EDJE_PICK_RESAMPLE_H
+#define EDJE_PICK_RESAMPLE_H
+
+/* Area filtered downscaling of premultiplied ARGB32 images. Each output
+   pixel is the coverage weighted mean of the source pixels under it.
+   Source rows are added in blocks of a constant pixel count, and output
+   pixels sum their 4 channels together, so both passes are vectorized
+   at -O2 for whatever SIMD the target has. */
+
+/* Scale src (sw x sh) to dst (dw x dh), dw <= sw and dh <= sh.
+   Returns 0 if a row buffer could not be allocated. */
+int edje_pick_resample(const unsigned int *src, unsigned int sw,
+      unsigned int sh, unsigned int *dst, unsigned int dw, unsigned int dh);
+
+#endif
@@ -0,0 +1,297 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <Eina.h>
+#include <Eet.h>
+#include <Edje.h>
+
+#include "Edje_Pick.h"
+#include "edje_pick_private.h"
+#include "edje_pick_merge.h"
+
+typedef struct _Edje_Pick_Unit Edje_Pick_Unit;
+struct _Edje_Pick_Unit
+{  /* One output of --split */
+   char *path;
+   Edje_Pick_Merge *m;
+   unsigned int groups;
+};
+
+static void
+_edje_pick_split_path(const Edje_Pick_Opts *o, const char *group,
+      char *path, size_t size)
+{  /* DIR/<first split_depth parts of group>.edj. Characters that are not
+      safe in a file name become '_', as do "." and ".." parts, so every
+      path stays in DIR. Groups mapping to the same path share it. */
+   unsigned int parts = 0;
+   size_t n, len;
+   const char *p;
+
+   n = snprintf(path, size, "%s/", o->split);
+   for (p = group; *p && (n + 5 < size); p += len)
+     {
+        len = strcspn(p, "/");
+        if ((!len) && *p)
+          {  /* Empty part */
+             len = 1;
+             continue;
+          }
+
+        if (o->split_depth && (parts == o->split_depth))
+          break;
+
+        if (parts++)
+          path[n++] = '/';
+
+        if (((len == 1) && (p[0] == '.')) ||
+              ((len == 2) && (p[0] == '.') && (p[1] == '.')))
+          path[n++] = '_';
+        else
+          {
+             size_t k;
+
+             for (k = 0; (k < len) && (n + 5 < size); k++)
+               path[n++] = (((p[k] >= 'a') && (p[k] <= 'z')) ||
+                     ((p[k] >= 'A') && (p[k] <= 'Z')) ||
+                     ((p[k] >= '0') && (p[k] <= '9')) ||
+                     (p[k] == '.') || (p[k] == '-') || (p[k] == '_')) ?
+                  p[k] : '_';
+          }
+
+        if (p[len] == '/')
+          len++;
+     }
+
+   if (!parts)
+     path[n++] = '_';
+
+   snprintf(path + n, size - n, ".edj");
+}
+
+static Eina_Bool
+_edje_pick_dirs_make(const char *path)
+{  /* Create the missing directories leading to file path */
+   char buf[PATH_MAX];
+   char *p;
+
+   snprintf(buf, sizeof(buf), "%s", path);
+   for (p = strchr(buf + 1, '/'); p; p = strchr(p + 1, '/'))
+     {
+        *p = '\0';
+        if ((mkdir(buf, 0755) < 0) && (errno != EEXIST))
+          {
+             EINA_LOG_ERR("Failed to create directory '%s'\n", buf);
+             return EINA_FALSE;
+          }
+
+        *p = '/';
+     }
+
+   return EINA_TRUE;
+}
+
+static void
+_edje_pick_split_add(const Edje_Pick_Opts *o, Eina_Hash *units,
+      Eina_List **order, const char *file, const char *group)
+{
+   Edje_Pick_Unit *u;
+   char path[PATH_MAX];
+
+   _edje_pick_split_path(o, group, path, sizeof(path));
+   u = eina_hash_find(units, path);
+   if (!u)
+     {
+        u = calloc(1, sizeof(Edje_Pick_Unit));
+        u->path = strdup(path);
+        u->m = edje_pick_merge_new(path);
+        eina_hash_add(units, path, u);
+        *order = eina_list_append(*order, u);
+     }
+
+   edje_pick_merge_group_add(u->m, file, group);
+   u->groups++;
+}
+
+static Eina_List *
+_edje_pick_split_units(const Edje_Pick_Opts *o)
+{  /* Outputs for the groups selected in argv, -a taking all of a file */
+   Eina_Hash *units = eina_hash_string_superfast_new(NULL);
+   Eina_List *order = NULL;
+   Eina_List *groups, *l;
+   const char *input = NULL;
+   const char *group;
+   int i;
+
+   for (i = 1; (i + 1) < o->argc; i++)
+     {
+        if (!strcmp(o->argv[i], "-i"))
+          input = o->argv[++i];
+        else if (!strcmp(o->argv[i], "-g") && input)
+          _edje_pick_split_add(o, units, &order, input, o->argv[++i]);
+        else if (!strcmp(o->argv[i], "-a"))
+          {
+             groups = edje_file_collection_list(o->argv[++i]);
+             EINA_LIST_FOREACH(groups, l, group)
+               _edje_pick_split_add(o, units, &order, o->argv[i], group);
+
+             edje_file_collection_list_free(groups);
+          }
+     }
+
+   eina_hash_free(units);
+   return order;
+}
+
+static int
+_edje_pick_split_worker(Edje_Pick_Unit **units, unsigned int count,
+      unsigned int first, unsigned int step)
+{  /* Build units first, first + step, ... Returns the first failure.
+      Workers are forked with EFL down, each brings up its own. */
+   Edje_Pick_Unit *u;
+   unsigned int i;
+   int status = EDJE_PICK_NO_ERROR;
+   int s;
+
+   edje_init();
+   for (i = first; i < count; i += step)
+     {
+        u = units[i];
+        s = edje_pick_merge_run(u->m);
+        if (s == EDJE_PICK_NO_ERROR)
+          continue;
+
+        EINA_LOG_ERR("%s: %s\n", u->path, edje_pick_err_str_get(s));
+        if (status == EDJE_PICK_NO_ERROR)
+          status = s;
+     }
+
+   edje_shutdown();
+   return status;
+}
+
+int
+_edje_pick_split(Edje_Pick_Opts *o)
+{  /* Build the outputs in forked workers, edje_pick_process() is not
+      thread safe. edje is only up to list the groups, and is shut down
+      before forking: nothing decoded is shared, every worker opens and
+      parses the inputs it merges. They do share the input pages the
+      prefetch left in the page cache. */
+   Edje_Pick_Stats *st = o->stats;
+   Eina_List *units, *l;
+   Edje_Pick_Unit **arr = NULL;
+   Edje_Pick_Unit *u;
+   pid_t *pids = NULL;
+   unsigned int count, started, n, i;
+   int status = EDJE_PICK_NO_ERROR;
+   int ws;
+   double t0;
+
+   if (o->output)
+     {
+        EINA_LOG_ERR("%s writes to its directory, -o is not used\n",
+              EDJE_PICK_OPT_SPLIT);
+        return EDJE_PICK_PARSE_FAILED;
+     }
+
+   edje_init();
+   units = _edje_pick_split_units(o);
+   edje_shutdown();
+   if (!units)
+     return EDJE_PICK_NO_GROUP;
+
+   EINA_LIST_FOREACH(units, l, u)
+     {
+        if (o->dry_run)
+          printf("%s: %u groups\n", u->path, u->groups);
+        else if (!_edje_pick_dirs_make(u->path))
+          status = EDJE_PICK_FAILED_OPEN_OUT;
+     }
+
+   if (o->dry_run || (status != EDJE_PICK_NO_ERROR))
+     goto end;
+
+   count = eina_list_count(units);
+   n = o->jobs ? o->jobs : (unsigned int) eina_cpu_count();
+   if (n > count)
+     n = count;
+
+   arr = malloc(count * sizeof(Edje_Pick_Unit *));
+   pids = calloc(n, sizeof(pid_t));
+   if ((!arr) || (!pids))
+     {
+        EINA_LOG_ERR("Failed to allocate %u %s outputs\n", count,
+              EDJE_PICK_OPT_SPLIT);
+        status = EDJE_PICK_FAILED_OPEN_OUT;
+        goto end;
+     }
+
+   i = 0;
+   EINA_LIST_FOREACH(units, l, u)
+     arr[i++] = u;
+
+   t0 = _edje_pick_time_get();
+   for (started = 1; started < n; started++)
+     {  /* This process is worker 0 */
+        pids[started] = fork();
+        if (!pids[started])
+          _exit(_edje_pick_split_worker(arr, count, started, n));
+        else if (pids[started] < 0)
+          break;
+     }
+
+   for (i = 0; i < n; i++)
+     {  /* Our share, and that of the workers that could not start */
+        if ((i > 0) && (i < started))
+          continue;
+
+        ws = _edje_pick_split_worker(arr, count, i, n);
+        if (status == EDJE_PICK_NO_ERROR)
+          status = ws;
+     }
+
+   for (i = 1; i < started; i++)
+     {
+        if ((waitpid(pids[i], &ws, 0) < 0) || (!WIFEXITED(ws)))
+          ws = EDJE_PICK_FAILED_CLOSE_OUT;
+        else
+          ws = WEXITSTATUS(ws);
+
+        if (status == EDJE_PICK_NO_ERROR)
+          status = ws;
+     }
+
+   _edje_pick_stats_phase_add(st, EDJE_PICK_PHASE_MERGE, t0);
+   if (st)
+     {  /* Outputs are read with eet, down with the rest here */
+        eet_init();
+        EINA_LIST_FOREACH(units, l, u)
+          _edje_pick_stats_output_add(st, u->path);
+
+        eet_shutdown();
+     }
+
+   _edje_pick_report(o, "Split: %u outputs in %s\n", count, o->split);
+
+end:
+   free(pids);
+   free(arr);
+   EINA_LIST_FREE(units, u)
+     {
+        edje_pick_merge_free(u->m);
+        free(u->path);
+        free(u);
+     }
+
+   return status;
+}
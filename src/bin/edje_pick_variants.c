@@ -0,0 +1,287 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EDJE_EDIT_IS_UNSTABLE_AND_I_KNOW_ABOUT_IT
+#include <Eina.h>
+#include <Evas.h>
+#include <Ecore_Evas.h>
+#include <Edje.h>
+#include <Edje_Edit.h>
+
+#include "edje_pick_variants.h"
+
+#ifdef EDJE_PICK_HAVE_IMAGE_SETS
+#define EDJE_PICK_VARIANTS_MAX_SIZE 65535
+
+static int
+_edje_pick_variants_cmp(const void *d1, const void *d2)
+{  /* Smallest first, sets list their images by growing size */
+   const Edje_Pick_Variant *a = d1;
+   const Edje_Pick_Variant *b = d2;
+
+   if (a->w != b->w)
+     return (a->w < b->w) ? -1 : 1;
+
+   return (a->h < b->h) ? -1 : (a->h > b->h);
+}
+
+static Eina_Bool
+_edje_pick_variant_image_add(Evas_Object *obj, const char *dir,
+      const Edje_Pick_Variant *v, char *name, size_t size)
+{  /* edje_edit only adds images from files, go through a PNG */
+   Evas_Object *img;
+   char path[PATH_MAX];
+   char *c;
+   Eina_Bool ret;
+
+   snprintf(name, size, "%s@%gx.png", v->image, v->scale);
+   for (c = name; *c; c++)
+     if (*c == '/')
+       *c = '_';
+
+   snprintf(path, sizeof(path), "%s/%s", dir, name);
+   img = evas_object_image_add(evas_object_evas_get(obj));
+   evas_object_image_colorspace_set(img, EVAS_COLORSPACE_ARGB8888);
+   evas_object_image_alpha_set(img, v->alpha);
+   evas_object_image_size_set(img, v->w, v->h);
+   evas_object_image_data_copy_set(img, v->pixels);
+   ret = evas_object_image_save(img, path, NULL, "compress=9");
+   evas_object_del(img);
+   if (!ret)
+     return EINA_FALSE;
+
+   /* The image is named after the file */
+   ret = edje_edit_image_add(obj, path);
+   unlink(path);
+   return ret;
+}
+
+static const char *
+_edje_pick_variants_set_make(Evas_Object *obj, const char *dir,
+      Edje_Pick_Variant *v, unsigned int count)
+{  /* Returns the set name, stringshare, or NULL if none was made */
+   const char **names;
+   const char *set = NULL;
+   char buf[PATH_MAX];
+   unsigned int i, n = 0, place = 0, w = 0, h = 0;
+
+   names = calloc(count, sizeof(const char *));
+   qsort(v, count, sizeof(Edje_Pick_Variant), _edje_pick_variants_cmp);
+   for (i = 0; i < count; i++)
+     {  /* names[i] stays NULL for variants not added */
+        if ((v[i].pixels) &&
+            (_edje_pick_variant_image_add(obj, dir, &v[i], buf, sizeof(buf))))
+          {
+             names[i] = eina_stringshare_add(buf);
+             n++;
+          }
+     }
+
+   if (n)
+     set = eina_stringshare_printf("%s@set", v[0].image);
+
+   if ((set) && (!edje_edit_image_set_add(obj, set)))
+     {
+        eina_stringshare_del(set);
+        set = NULL;
+     }
+
+   for (i = 0; (set) && (i < count); i++)
+     {
+        if (!names[i])
+          continue;
+
+        edje_edit_image_set_image_add(obj, set, names[i]);
+        edje_edit_image_set_image_min_set(obj, set, place,
+              place ? w + 1 : 0, place ? h + 1 : 0);
+        edje_edit_image_set_image_max_set(obj, set, place, v[i].w, v[i].h);
+        w = v[i].w;
+        h = v[i].h;
+        place++;
+     }
+
+   if (set)
+     {  /* The image itself for anything bigger */
+        edje_edit_image_set_image_add(obj, set, v[0].image);
+        edje_edit_image_set_image_min_set(obj, set, place, w + 1, h + 1);
+        edje_edit_image_set_image_max_set(obj, set, place,
+              EDJE_PICK_VARIANTS_MAX_SIZE, EDJE_PICK_VARIANTS_MAX_SIZE);
+     }
+
+   for (i = 0; i < count; i++)
+     eina_stringshare_del(names[i]);
+
+   free(names);
+   return set;
+}
+
+static Eina_Bool
+_edje_pick_variants_tweens_retarget(Evas_Object *obj, const char *part,
+      const char *state, double value, const Eina_Hash *sets)
+{  /* Tweens are frames in order: if one of them has a set, remove them
+      all and add them back in that order, through their sets */
+   Eina_List *tweens, *l;
+   const char *tween, *set;
+   Eina_Bool found = EINA_FALSE;
+
+   tweens = edje_edit_state_tweens_list_get(obj, part, state, value);
+   EINA_LIST_FOREACH(tweens, l, tween)
+     if (eina_hash_find(sets, tween))
+       found = EINA_TRUE;
+
+   if (found)
+     {
+        EINA_LIST_FOREACH(tweens, l, tween)
+          edje_edit_state_tween_del(obj, part, state, value, tween);
+
+        EINA_LIST_FOREACH(tweens, l, tween)
+          {
+             set = eina_hash_find(sets, tween);
+             edje_edit_state_tween_add(obj, part, state, value,
+                   set ? set : tween);
+          }
+     }
+
+   edje_edit_string_list_free(tweens);
+   return found;
+}
+
+static Eina_Bool
+_edje_pick_variants_retarget(Evas_Object *obj, const Eina_Hash *sets)
+{  /* Point image states and tweens of the loaded group at the sets.
+      True if any */
+   Eina_List *parts, *states, *l, *ll;
+   const char *part, *state, *image, *set;
+   char buf[1024], *sp;
+   double value;
+   Eina_Bool changed = EINA_FALSE;
+
+   parts = edje_edit_parts_list_get(obj);
+   EINA_LIST_FOREACH(parts, l, part)
+     {
+        if (edje_edit_part_type_get(obj, part) != EDJE_PART_TYPE_IMAGE)
+          continue;
+
+        states = edje_edit_part_states_list_get(obj, part);
+        EINA_LIST_FOREACH(states, ll, state)
+          {  /* States are listed as "name value" */
+             snprintf(buf, sizeof(buf), "%s", state);
+             sp = strrchr(buf, ' ');
+             if (!sp)
+               continue;
+
+             *sp = '\0';
+             value = atof(sp + 1);
+             image = edje_edit_state_image_get(obj, part, buf, value);
+             set = image ? eina_hash_find(sets, image) : NULL;
+             edje_edit_string_free(image);
+             if ((set) &&
+                 (edje_edit_state_image_set(obj, part, buf, value, set)))
+               changed = EINA_TRUE;
+
+             if (_edje_pick_variants_tweens_retarget(obj, part, buf, value,
+                      sets))
+               changed = EINA_TRUE;
+          }
+
+        edje_edit_string_list_free(states);
+     }
+
+   edje_edit_string_list_free(parts);
+   return changed;
+}
+#endif
+
+unsigned int
+edje_pick_variants_store(const char *file, Edje_Pick_Variant *v,
+      unsigned int count)
+{
+#ifdef EDJE_PICK_HAVE_IMAGE_SETS
+   Ecore_Evas *ee;
+   Evas_Object *obj, *gobj;
+   Eina_List *groups, *l, *made_sets = NULL, *edited = NULL;
+   Eina_Hash *sets;
+   const char *group, *set;
+   char dir[] = "/tmp/edje_pick-XXXXXX";
+   unsigned int i, j, made;
+
+   if (!count)
+     return 0;
+
+   groups = edje_file_collection_list(file);
+   if (!groups)
+     return 0;
+
+   ecore_evas_init();
+   ee = ecore_evas_buffer_new(1, 1);
+   if ((!ee) || (!mkdtemp(dir)))
+     {
+        if (ee)
+          ecore_evas_free(ee);
+
+        ecore_evas_shutdown();
+        edje_file_collection_list_free(groups);
+        return 0;
+     }
+
+   obj = edje_edit_object_add(ecore_evas_get(ee));
+   sets = eina_hash_string_superfast_new(NULL);
+   if (edje_object_file_set(obj, file, eina_list_data_get(groups)))
+     {
+        for (i = 0; i < count; i = j)
+          {  /* One set for each run of variants of the same image */
+             for (j = i + 1; (j < count) && (!strcmp(v[i].image, v[j].image));
+                  j++);
+
+             set = _edje_pick_variants_set_make(obj, dir, &v[i], j - i);
+             if (!set)
+               continue;
+
+             eina_hash_add(sets, v[i].image, set);
+             made_sets = eina_list_append(made_sets, set);
+          }
+     }
+
+   made = eina_list_count(made_sets);
+   if (made)
+     {  /* An object per retargeted group keeps its edits loaded, then
+           one save writes them all with the file data, sets included */
+        EINA_LIST_FOREACH(groups, l, group)
+          {
+             gobj = edje_edit_object_add(ecore_evas_get(ee));
+             if ((edje_object_file_set(gobj, file, group)) &&
+                 (_edje_pick_variants_retarget(gobj, sets)))
+               edited = eina_list_append(edited, gobj);
+             else
+               evas_object_del(gobj);
+          }
+
+        edje_edit_save_all(obj);
+        EINA_LIST_FREE(edited, gobj)
+          evas_object_del(gobj);
+     }
+
+   rmdir(dir);
+   eina_hash_free(sets);
+   EINA_LIST_FREE(made_sets, set)
+     eina_stringshare_del(set);
+
+   evas_object_del(obj);
+   ecore_evas_free(ee);
+   ecore_evas_shutdown();
+   edje_file_collection_list_free(groups);
+   return made;
+#else
+   (void) file;
+   (void) v;
+   (void) count;
+   return 0;
+#endif
+}
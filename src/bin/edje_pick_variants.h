@@ -0,0 +1,32 @@
+#ifndef EDJE_PICK_VARIANTS_H
+#define EDJE_PICK_VARIANTS_H
+
+#include <Eina.h>
+#include <Edje.h>
+
+/* Scaled image variants stored as edje image sets. Image sets can be
+   edited since edje 1.18, older ones get no variants. */
+#if (EDJE_VERSION_MAJOR > 1) || (EDJE_VERSION_MINOR >= 18)
+# define EDJE_PICK_HAVE_IMAGE_SETS 1
+#endif
+
+typedef struct _Edje_Pick_Variant Edje_Pick_Variant;
+struct _Edje_Pick_Variant
+{
+   const char *image;       /* Image it is a variant of */
+   double scale;
+   unsigned int w, h;       /* Its size */
+   unsigned int ow, oh;     /* Size of the image */
+   Eina_Bool alpha;
+   unsigned int *pixels;    /* Premultiplied ARGB32, NULL to skip */
+};
+
+/* Add the variants to file as images. Each image gets a set holding its
+   variants and itself, picked by displayed size, and every part state
+   showing the image is pointed at that set. Variants of an image must
+   be next to each other. Returns the number of sets made. Needs edje
+   initialized. */
+unsigned int edje_pick_variants_store(const char *file, Edje_Pick_Variant *v,
+      unsigned int count);
+
+#endif
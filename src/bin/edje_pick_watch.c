@@ -0,0 +1,191 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
+
+#include <Eina.h>
+#include <Eet.h>
+#include <Ecore.h>
+
+#include "Edje_Pick.h"
+#include "edje_pick_private.h"
+
+/* Seconds without input changes before --watch rebuilds */
+#define EDJE_PICK_WATCH_DEBOUNCE 0.15
+
+#ifdef HAVE_SYS_INOTIFY_H
+typedef struct _Edje_Pick_Watch Edje_Pick_Watch;
+struct _Edje_Pick_Watch
+{
+   Eina_List *targets;   /* Edje_Pick_Opts of the outputs to keep built */
+   Eina_Hash *files;     /* "wd/basename" to input name (stringshare) */
+   Eina_Hash *changed;   /* Input names rewritten since last rebuild */
+   Ecore_Timer *timer;   /* Debounce, rebuild when it expires */
+   int fd;
+};
+
+static void
+_edje_pick_watch_input_add(Edje_Pick_Watch *w, const char *name)
+{  /* Watch the directory, so inputs replaced by rename are seen too */
+   const char *base = strrchr(name, '/');
+   char dir[PATH_MAX];
+   char key[PATH_MAX + 16];
+   int wd;
+
+   if (base)
+     snprintf(dir, sizeof(dir), "%.*s", (int) (base - name + 1), name);
+   else
+     strcpy(dir, ".");
+
+   base = base ? base + 1 : name;
+   wd = inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+   if (wd < 0)
+     {
+        EINA_LOG_ERR("Failed to watch '%s'\n", dir);
+        return;
+     }
+
+   snprintf(key, sizeof(key), "%d/%s", wd, base);
+   if (!eina_hash_find(w->files, key))
+     eina_hash_add(w->files, key, name);
+}
+
+static Eina_Bool
+_edje_pick_watch_rebuild(void *data)
+{  /* Rebuild each output reading a changed input, the others are kept.
+      Unchanged inputs are still cached by eet from the previous runs.
+      The whole merge runs again: edje_pick_process() writes complete
+      outputs and has no way to replace some groups of one. */
+   Edje_Pick_Watch *w = data;
+   Edje_Pick_Opts *t;
+   Eina_List *l;
+   unsigned int i;
+   double t0;
+   int status;
+
+   w->timer = NULL;
+   EINA_LIST_FOREACH(w->targets, l, t)
+     {
+        for (i = 0; i < t->inputs_count; i++)
+          if (eina_hash_find(w->changed, t->inputs[i].name))
+            break;
+
+        if (i == t->inputs_count)
+          continue;
+
+        t0 = _edje_pick_time_get();
+        _edje_pick_inputs_release(t);
+        _edje_pick_inputs_stage(t);
+        status = _edje_pick_run(t);
+        if (status == EDJE_PICK_NO_ERROR)
+          printf("Rebuilt '%s' in %.3fs\n", t->output,
+                _edje_pick_time_get() - t0);
+        else
+          printf("Rebuilding '%s' failed: %s\n", t->output,
+                edje_pick_err_str_get(status));
+
+        fflush(stdout);
+     }
+
+   eina_hash_free_buckets(w->changed);
+   return ECORE_CALLBACK_CANCEL;
+}
+
+static Eina_Bool
+_edje_pick_watch_event(void *data, Ecore_Fd_Handler *fdh EINA_UNUSED)
+{  /* Collect rewritten inputs and (re)arm the debounce timer */
+   Edje_Pick_Watch *w = data;
+   const struct inotify_event *ev;
+   char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+   char key[PATH_MAX + 16];
+   const char *name;
+   ssize_t len;
+   char *p;
+
+   while ((len = read(w->fd, buf, sizeof(buf))) > 0)
+     for (p = buf; p < (buf + len); p += sizeof(*ev) + ev->len)
+       {
+          ev = (const struct inotify_event *) p;
+          if (!ev->len)
+            continue;
+
+          snprintf(key, sizeof(key), "%d/%s", ev->wd, ev->name);
+          name = eina_hash_find(w->files, key);
+          if (name && !eina_hash_find(w->changed, name))
+            eina_hash_add(w->changed, name, name);
+       }
+
+   if (eina_hash_population(w->changed))
+     {
+        if (w->timer)
+          ecore_timer_del(w->timer);
+
+        w->timer = ecore_timer_add(EDJE_PICK_WATCH_DEBOUNCE,
+              _edje_pick_watch_rebuild, w);
+     }
+
+   return ECORE_CALLBACK_RENEW;
+}
+
+int
+_edje_pick_watch(Eina_List *targets)
+{  /* Keep targets built until interrupted. Returns once the main loop
+      quits, which ecore does on SIGINT and SIGTERM. */
+   Ecore_Fd_Handler *fdh;
+   Edje_Pick_Watch w;
+   Edje_Pick_Opts *t;
+   Eina_List *l;
+   unsigned int i;
+
+   memset(&w, 0, sizeof(w));
+   w.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if (w.fd < 0)
+     {
+        EINA_LOG_ERR("Failed to set up input watching\n");
+        return EDJE_PICK_PARSE_FAILED;
+     }
+
+   ecore_init();
+   w.targets = targets;
+   w.files = eina_hash_string_superfast_new(NULL);
+   w.changed = eina_hash_string_superfast_new(NULL);
+   EINA_LIST_FOREACH(targets, l, t)
+     for (i = 0; i < t->inputs_count; i++)
+       _edje_pick_watch_input_add(&w, t->inputs[i].name);
+
+   fdh = ecore_main_fd_handler_add(w.fd, ECORE_FD_READ,
+         _edje_pick_watch_event, &w, NULL, NULL);
+
+   printf("Watching %u inputs, interrupt to stop\n",
+         eina_hash_population(w.files));
+   fflush(stdout);
+   eet_cacheburst(EINA_TRUE);
+   ecore_main_loop_begin();
+   eet_cacheburst(EINA_FALSE);
+
+   if (w.timer)
+     ecore_timer_del(w.timer);
+
+   ecore_main_fd_handler_del(fdh);
+   eina_hash_free(w.files);
+   eina_hash_free(w.changed);
+   close(w.fd);
+   ecore_shutdown();
+   return EDJE_PICK_NO_ERROR;
+}
+#else
+int
+_edje_pick_watch(Eina_List *targets EINA_UNUSED)
+{
+   EINA_LOG_ERR("%s is not supported on this platform\n",
+         EDJE_PICK_OPT_WATCH);
+   return EDJE_PICK_PARSE_FAILED;
+}
+#endif
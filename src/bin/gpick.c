@@ -4,6 +4,9 @@
 
 #include <Elementary.h>
 #include "Edje_Pick.h"
+#include "edje_pick_plan.h"
+#include "edje_pick_merge.h"
+#include "edje_pick_eet.h"
 
 #define CLIENT_NAME         "Edje-Pick Client"
 
@@ -160,6 +163,7 @@ struct _gui_elements
    Elm_Genlist_Item_Class itc;
    Elm_Genlist_Item_Class itc_group;
    Edje_Pick *context;
+   Edje_Pick_Plan *plan;  /* Checks take and drop, caches file info */
 
    gl_actions actions;  /* For UNDO, REDO */
 };
@@ -326,6 +330,7 @@ _gui_alloc(void)
 {  /* Will do any complex-allocation proc here */
    gui_elements *g = calloc(1, sizeof(gui_elements));
    g->context = edje_pick_context_new();
+   g->plan = edje_pick_plan_new();
    return g;
 }
 
@@ -385,6 +390,7 @@ _gui_free(gui_elements *g)
 
    _actions_list_clear(&(g->actions));
 
+   edje_pick_plan_free(g->plan);
    edje_pick_context_free(g->context);
    free(g);
 }
@@ -428,13 +434,13 @@ _edje_pick_image_object_data_read(Evas_Object *o,
    int alpha;
    int compression;
    int quality;
-   int lossy;
+   Eet_Image_Encoding lossy;
    Eet_File *ef = eet_open(file_name, EET_FILE_MODE_READ);
 
    if (ef)
      {
         char buf[1024];
-        snprintf(buf, sizeof(buf), "edje/images/%i", ex->id);
+        snprintf(buf, sizeof(buf), EDJE_PICK_IMAGE_ENTRY, ex->id);
         img = eet_data_image_read(ef,
               buf,
               w,
@@ -444,15 +450,17 @@ _edje_pick_image_object_data_read(Evas_Object *o,
               &quality,
               &lossy);
 
+        eet_close(ef);
         if (img)
-          {
+          {  /* Alpha as stored, edje_pick --opaque clears it if unused */
              evas_object_size_hint_min_set(o, *w, *h);
              evas_object_image_colorspace_set(o, EVAS_COLORSPACE_ARGB8888);
-             evas_object_image_alpha_set(o, EINA_FALSE);
+             evas_object_image_alpha_set(o, alpha);
              evas_object_image_size_set(o, *w, *h);
              evas_object_image_data_copy_set(o, img);
              evas_object_image_data_update_add(o, 0, 0, *w, *h);
              evas_object_show(o);
+             free(img);  /* data_copy_set() took a copy */
              return EINA_TRUE;
           }
      }
@@ -676,7 +684,8 @@ _sample_preview_timeout(void *data)
                      {  /* Read sample info from file */
                         Eet_File *ef = eet_open(info->file_name,
                               EET_FILE_MODE_READ);
-                        snprintf(buf, sizeof(buf), "edje/sounds/%i", ex->id);
+                        snprintf(buf, sizeof(buf), EDJE_PICK_SAMPLE_ENTRY,
+                              ex->id);
                         st->sample = (void *) eet_read_direct(ef,
                               (const char *) buf, &st->size);
                         eet_close(ef);
@@ -1591,101 +1600,54 @@ _file_selector_show(gui_elements *g,  Evas_Smart_Cb func, Eina_Bool is_save)
    evas_object_show(g->inwin);
 }
 
-static char **
-_command_line_args_make(gui_elements *g, Eina_List *s,
-      const char *prog, const char *outfile, int *argc,
-      Eina_Bool strict)
-{  /* User has to free returned char ** */
-#define ADD_ARG(LIST, STR, CNT) do{ \
-     LIST = eina_list_append(LIST, STR); \
-     CNT++; \
-}while(0);
-   char **argv = NULL;
-   Eina_List *args = NULL;
+static void
+_merge_replaces_add(gui_elements *g, Edje_Pick_Merge *m, const char *list,
+      Edje_Pick_Dep_Type type)
+{  /* Add the replacements made to resources of a taken list */
+   Elm_Object_Item *it = _glit_head_list_node_find(g->gl_dst, NULL, list);
+   gl_item_info *info, *res, *r;
    Eina_List *l;
-   Elm_Object_Item *it;
-   gl_item_info *info;
-   unsigned int i;
 
-   ADD_ARG(args, prog, (*argc));  /* Add program-name as argv[0] */
+   if (!it)
+     return;
+
+   info = elm_object_item_data_get(it);
+   EINA_LIST_FOREACH(info->sub, l, res)
+     {
+        if (!res->r)
+          continue;
+
+        /* Last replacement is the one shown, see _group_item_icon_get() */
+        r = eina_list_data_get(eina_list_last(res->r));
+        if (type == EDJE_PICK_DEP_FONT)
+          edje_pick_merge_replace_add(m, type, res->name, r->file_name,
+                -1, r->name);
+        else
+          edje_pick_merge_replace_add(m, type, res->name, r->file_name,
+                ((image_info_ex *) r->ex)->id, NULL);
+     }
+}
+
+static Edje_Pick_Merge *
+_merge_spec_make(gui_elements *g, const char *outfile)
+{  /* Spec of what is taken, user has to free it */
+   Edje_Pick_Merge *m = edje_pick_merge_new(outfile);
+   Elm_Object_Item *it;
+   gl_item_info *info, *group;
+   Eina_List *l;
 
    it = _glit_head_list_node_find(g->gl_dst, NULL, EDJE_PICK_GROUPS_STR);
    if (it)
-     {  /* Run through taken-groups and build args-list */
+     {  /* Run through taken-groups */
         info = elm_object_item_data_get(it);
-        gl_item_info *group;
         EINA_LIST_FOREACH(info->sub, l, group)
-          {
-             ADD_ARG(args, "-i", (*argc));
-             ADD_ARG(args, group->file_name, (*argc));
-             ADD_ARG(args, "-g", (*argc));
-             ADD_ARG(args, group->name, (*argc));
-          }
+          edje_pick_merge_group_add(m, group->file_name, group->name);
      }
 
-   EINA_LIST_FOREACH(s, l, info)
-     {  /* Run through selected-items and build args-list */
-        switch(info->type)
-          {
-           case EDJE_PICK_TYPE_FILE:
-                {  /* Update pointer to Groups pointer, and continue in LIST */
-                   if (strict)
-                     {
-                        info = eina_list_search_unsorted(info->sub,
-                              _item_name_cmp, EDJE_PICK_GROUPS_STR);
-                     }
-                }
-
-           case EDJE_PICK_TYPE_LIST:
-                {
-                   if (strict)
-                     {  /* Makes sure no duplicate groups */
-                        gl_item_info *group;
-                        Eina_List *ll;
-                        ADD_ARG(args, "-i", (*argc));
-                        ADD_ARG(args, info->file_name, (*argc));
-                        EINA_LIST_FOREACH(info->sub, ll, group)
-                          {
-                             ADD_ARG(args, "-g", (*argc));
-                             ADD_ARG(args, group->name, (*argc));
-                          }
-                     }
-                   else
-                     {  /* Include all groups from a file */
-                        ADD_ARG(args, "-a", (*argc));
-                        ADD_ARG(args, info->file_name, (*argc));
-                     }
-                   break;
-                }
-
-           case EDJE_PICK_TYPE_GROUP:
-                {  /* Include a specific group from a file */
-                   ADD_ARG(args, "-i", (*argc));
-                   ADD_ARG(args, info->file_name, (*argc));
-                   ADD_ARG(args, "-g", (*argc));
-                   ADD_ARG(args, info->name, (*argc));
-                   break;
-                }
-
-           default:
-              break;
-          }
-     }
-
-   ADD_ARG(args, "-o", (*argc));
-   ADD_ARG(args, outfile, (*argc));  /* Add output file name arg */
-
-   /* Compose argv-like string array */
-   argv = calloc(eina_list_count(args), sizeof(char *));
-   for(i = 0; i < eina_list_count(args); i++)
-     {
-        argv[i] = eina_list_nth(args, i);
-        printf("%s ", argv[i]);
-     }
-
-   eina_list_free(args);
-   return argv;
-#undef ADD_ARG
+   _merge_replaces_add(g, m, EDJE_PICK_IMAGES_STR, EDJE_PICK_DEP_IMAGE);
+   _merge_replaces_add(g, m, EDJE_PICK_SAMPLES_STR, EDJE_PICK_DEP_SAMPLE);
+   _merge_replaces_add(g, m, EDJE_PICK_FONTS_STR, EDJE_PICK_DEP_FONT);
+   return m;
 }
 
 
@@ -2004,6 +1966,104 @@ _edje_pick_items_move(gui_elements *g,
  _window_setting_update(g);
 }
 
+static void
+_plan_groups_add(Edje_Pick_Plan *p, gl_item_info *info)
+{  /* Add groups under a list item (or the group item itself) to plan */
+   gl_item_info *group;
+   Eina_List *l;
+
+   if (info->type == EDJE_PICK_TYPE_GROUP)
+     {
+        edje_pick_plan_group_add(p, info->file_name, info->name);
+        return;
+     }
+
+   EINA_LIST_FOREACH(info->sub, l, group)
+     if (group->type == EDJE_PICK_TYPE_GROUP)
+       edje_pick_plan_group_add(p, group->file_name, group->name);
+}
+
+static Edje_Pick_Status
+_selection_check(gui_elements *g, Eina_List *s)
+{  /* Check taken groups along with selection s for conflicts.
+      Done in memory, file info is read once and kept in g->plan */
+   Elm_Object_Item *it;
+   gl_item_info *info;
+   Eina_List *l;
+
+   edje_pick_context_set(g->context);
+   edje_pick_plan_reset(g->plan);
+   it = _glit_head_list_node_find(g->gl_dst, NULL, EDJE_PICK_GROUPS_STR);
+   if (it)
+     _plan_groups_add(g->plan, elm_object_item_data_get(it));
+
+   EINA_LIST_FOREACH(s, l, info)
+     {
+        if (info->type == EDJE_PICK_TYPE_FILE)
+          info = eina_list_search_unsorted(info->sub,
+                _item_name_cmp, EDJE_PICK_GROUPS_STR);
+
+        if (info)
+          _plan_groups_add(g->plan, info);
+     }
+
+   return edje_pick_plan_status_get(g->plan);
+}
+
+static Eina_Bool
+_closure_group_add(const Eina_Hash *hash EINA_UNUSED, const void *key,
+      void *data EINA_UNUSED, void *fdata)
+{  /* Add info of group 'key' to the selection, if not there yet */
+   void **ctx = fdata;  /* Groups list info, then the selection */
+   gl_item_info *list = ctx[0];
+   gl_item_info *group = eina_list_search_unsorted(list->sub,
+         _item_name_cmp, key);
+
+   if (group && !eina_list_data_find(ctx[1], group))
+     ctx[1] = eina_list_append(ctx[1], group);
+
+   return EINA_TRUE;
+}
+
+static Eina_List *
+_selection_closure_add(gui_elements *g, Evas_Object *gl, Eina_List *s)
+{  /* Taking a group takes the groups it pulls in as well, looked up
+      in the dependency index of its file */
+   const Edje_Pick_Index *idx;
+   Elm_Object_Item *it;
+   Eina_List *l, *groups = NULL;
+   gl_item_info *info;
+   Eina_Hash *reach;
+   void *ctx[2];
+
+   EINA_LIST_FOREACH(s, l, info)
+     if (info->type == EDJE_PICK_TYPE_GROUP)
+       groups = eina_list_append(groups, info);
+
+   ctx[1] = s;
+   EINA_LIST_FREE(groups, info)
+     {
+        Eina_List *one = eina_list_append(NULL, info->name);
+
+        edje_pick_context_set(g->context);
+        idx = edje_pick_plan_index_get(g->plan, info->file_name);
+        it = _glit_head_list_node_find(gl, info->file_name,
+              EDJE_PICK_GROUPS_STR);
+        if (idx && it)
+          {
+             reach = edje_pick_index_reachable_get(idx, one,
+                   EDJE_PICK_DEP_GROUP);
+             ctx[0] = elm_object_item_data_get(it);
+             eina_hash_foreach(reach, _closure_group_add, ctx);
+             eina_hash_free(reach);
+          }
+
+        eina_list_free(one);
+     }
+
+   return ctx[1];
+}
+
 static void
 _take_bt_clicked(void *data EINA_UNUSED,
       Evas_Object *obj EINA_UNUSED, void *event_info EINA_UNUSED)
@@ -2022,27 +2082,20 @@ _take_bt_clicked(void *data EINA_UNUSED,
    /* First check OK to move groups */
    if (s)
      {
-        int argc = 0;
-        Edje_Pick_Status status = EDJE_PICK_NO_ERROR;
-        char **argv = _command_line_args_make(g, s, g->argv0,
-              "/tmp/out.tmp", &argc, EINA_TRUE);
+        Edje_Pick_Status status;
 
-        edje_pick_context_set(g->context);
-        status = edje_pick_command_line_parse(argc, argv,
-              NULL, NULL, EINA_TRUE);
+        s = _selection_closure_add(g, g->gl_src, s);
+        status = _selection_check(g, s);
 
-        free(argv);
         if (status != EDJE_PICK_NO_ERROR)
           {  /* Parse came back with an error */
              printf("%s\n", edje_pick_err_str_get(status));
              _ok_popup_show(data, _cancel_popup, "Error",
                    (char *) edje_pick_err_str_get(status));
           }
-        else
-          {  /* Add the selection to dest list */
-             printf("\n\nParse OK\n");
-             _edje_pick_items_move(g, g->gl_src, g->gl_dst, s, EINA_TRUE);
-          }
+        else  /* Add the selection to dest list */
+          _edje_pick_items_move(g, g->gl_src, g->gl_dst, s, EINA_TRUE);
+
         eina_list_free(s);
      }
 
@@ -2292,18 +2345,17 @@ _save_bt_clicked(void *data,
 {
 
    gui_elements *g = data;
-   char **argv = NULL;
-   int i, argc = 0;
+   Edje_Pick_Merge *m;
+   int i;
 
    /* Compose a temporary output file name */
    char *tmp_file_name = malloc(strlen(g->file_name) + 16);
    sprintf(tmp_file_name, "%s_%lld", g->file_name, (long long) time(NULL));
-   argv = _command_line_args_make(g, NULL, g->argv0, tmp_file_name, &argc,
-         EINA_FALSE);
+   m = _merge_spec_make(g, tmp_file_name);
 
    edje_pick_context_set(g->context);
-   i = edje_pick_process(argc, argv);
-   free(argv);
+   i = edje_pick_merge_run(m);
+   edje_pick_merge_free(m);
 
    if (i != EDJE_PICK_NO_ERROR)
      {
@@ -2330,6 +2382,7 @@ _save_bt_clicked(void *data,
      }
 
    free(tmp_file_name);
+   edje_pick_plan_file_forget(g->plan, g->file_name);
 
    g->modified = EINA_FALSE;
 
@@ -2351,15 +2404,12 @@ _save_as_bt_do(void *data, Evas_Object *obj EINA_UNUSED, void *event_info)
 
    if (event_info)
      {
-        char **argv = NULL;
-        int i, argc = 0;
-
-        argv = _command_line_args_make(g, NULL, g->argv0, event_info, &argc,
-              EINA_FALSE);
+        Edje_Pick_Merge *m = _merge_spec_make(g, event_info);
+        int i;
 
         edje_pick_context_set(g->context);
-        i = edje_pick_process(argc, argv);
-        free(argv);
+        i = edje_pick_merge_run(m);
+        edje_pick_merge_free(m);
 
         if (i != EDJE_PICK_NO_ERROR)
           {
@@ -2368,6 +2418,7 @@ _save_as_bt_do(void *data, Evas_Object *obj EINA_UNUSED, void *event_info)
              return;
           }
 
+        edje_pick_plan_file_forget(g->plan, event_info);
         g->file_name = eina_stringshare_add(event_info);
         g->modified = EINA_FALSE;
         _window_setting_update(g);
@@ -2895,16 +2946,9 @@ _gl_dropcb(void *data, Evas_Object *obj,
           {
              Edje_Pick_Status status = EDJE_PICK_NO_ERROR;
              if (obj == g->gl_dst)
-               {  /* Parse when dropped on dest */
-                  int argc = 0;
-                  char **argv = _command_line_args_make(g, s, g->argv0,
-                        "/tmp/out.tmp", &argc, EINA_TRUE);
-
-                  edje_pick_context_set(g->context);
-                  status = edje_pick_command_line_parse(argc, argv,
-                        NULL, NULL, EINA_TRUE);
-
-                  free(argv);
+               {  /* Check when dropped on dest */
+                  s = _selection_closure_add(g, df, s);
+                  status = _selection_check(g, s);
                }
 
              if (status != EDJE_PICK_NO_ERROR)
@@ -2913,11 +2957,8 @@ _gl_dropcb(void *data, Evas_Object *obj,
                   _ok_popup_show(data, _cancel_popup, "Drop Error",
                         (char *) edje_pick_err_str_get(status));
                }
-             else
-               {  /* Add the selection to dest list */
-                  printf("\n\nParse OK\n");
-                  _edje_pick_items_move(g, df, obj, s, EINA_TRUE);
-               }
+             else  /* Add the selection to dest list */
+               _edje_pick_items_move(g, df, obj, s, EINA_TRUE);
 
              eina_list_free(s);
           }
@@ -0,0 +1,196 @@
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* 'make check': merge the same inputs twice with --reproducible, with a
+   different worker count so entries come in another order, and compare
+   the outputs byte for byte. EDJE_PICK and EDJE_CC name the programs,
+   exits 77 (skipped) when edje_cc can't be run. */
+
+#define TEST_INPUTS 2
+#define TEST_GROUPS 8
+#define TEST_SKIP 77
+
+static int
+_test_image_write(const char *path, unsigned int size, unsigned int seed)
+{  /* Binary PPM, content differs per seed so nothing dedups by accident */
+   unsigned int x, y;
+   FILE *fp = fopen(path, "wb");
+
+   if (!fp)
+     return 0;
+
+   fprintf(fp, "P6\n%u %u\n255\n", size, size);
+   for (y = 0; y < size; y++)
+     for (x = 0; x < size; x++)
+       {
+          fputc((x * 7 + seed) & 0xff, fp);
+          fputc((y * 5 + (seed >> 8)) & 0xff, fp);
+          fputc((x ^ y ^ seed) & 0xff, fp);
+       }
+
+   fclose(fp);
+   return 1;
+}
+
+static int
+_test_edc_write(const char *dir, const char *path, unsigned int input)
+{  /* Each group shows its own image */
+   char img[PATH_MAX];
+   unsigned int i;
+   FILE *fp = fopen(path, "w");
+
+   if (!fp)
+     return 0;
+
+   fprintf(fp, "images {\n");
+   for (i = 0; i < TEST_GROUPS; i++)
+     {
+        snprintf(img, sizeof(img), "%s/i%u_%u.ppm", dir, input, i);
+        if (!_test_image_write(img, 16 << (i % 3), i + input * 65536))
+          {
+             fclose(fp);
+             return 0;
+          }
+
+        fprintf(fp, "   image: \"i%u_%u.ppm\" %s;\n", input, i,
+              (i & 1) ? "RAW" : "COMP");
+     }
+
+   fprintf(fp, "}\ncollections {\n");
+   for (i = 0; i < TEST_GROUPS; i++)
+     {
+        fprintf(fp, "   group { name: \"test/%u/%u\";\n", input, i);
+        fprintf(fp, "      parts { part { name: \"img\"; type: IMAGE;\n");
+        fprintf(fp, "         description { state: \"default\" 0.0;\n");
+        fprintf(fp, "            image.normal: \"i%u_%u.ppm\"; } } }\n",
+              input, i);
+        fprintf(fp, "   }\n");
+     }
+
+   fprintf(fp, "}\n");
+   fclose(fp);
+   return 1;
+}
+
+static int
+_test_run(const char *cmd)
+{  /* Exit status of cmd, -1 if it did not exit */
+   int ret = system(cmd);
+
+   if ((ret < 0) || (!WIFEXITED(ret)))
+     return -1;
+
+   return WEXITSTATUS(ret);
+}
+
+static unsigned char *
+_test_file_read(const char *path, size_t *size)
+{
+   unsigned char *data = NULL;
+   struct stat st;
+   FILE *fp;
+
+   if ((stat(path, &st) < 0) || (!(fp = fopen(path, "rb"))))
+     return NULL;
+
+   *size = st.st_size;
+   data = malloc(*size ? *size : 1);
+   if (data && (fread(data, 1, *size, fp) != *size))
+     {
+        free(data);
+        data = NULL;
+     }
+
+   fclose(fp);
+   return data;
+}
+
+int
+main(void)
+{
+   const char *edje_cc = getenv("EDJE_CC") ? getenv("EDJE_CC") : "edje_cc";
+   const char *edje_pick = getenv("EDJE_PICK") ?
+      getenv("EDJE_PICK") : "edje_pick";
+   char dir[] = "/tmp/edje_pick_test-XXXXXX";
+   char edc[PATH_MAX], edj[TEST_INPUTS][PATH_MAX], out[2][PATH_MAX];
+   char cmd[PATH_MAX * 6];
+   unsigned char *data[2] = { NULL, NULL };
+   size_t size[2] = { 0, 0 };
+   int status = 1;
+   int i, ret;
+
+   if (!mkdtemp(dir))
+     {
+        fprintf(stderr, "edje_pick_test: failed to create '%s'\n", dir);
+        return 1;
+     }
+
+   for (i = 0; i < TEST_INPUTS; i++)
+     {
+        snprintf(edc, sizeof(edc), "%s/in_%d.edc", dir, i);
+        snprintf(edj[i], sizeof(edj[i]), "%s/in_%d.edj", dir, i);
+        if (!_test_edc_write(dir, edc, i))
+          goto end;
+
+        snprintf(cmd, sizeof(cmd), "'%s' -id '%s' '%s' '%s' > /dev/null",
+              edje_cc, dir, edc, edj[i]);
+        ret = _test_run(cmd);
+        if (ret == 127)
+          {  /* The shell did not find it */
+             fprintf(stderr, "edje_pick_test: no '%s', skipped\n", edje_cc);
+             status = TEST_SKIP;
+             goto end;
+          }
+        else if (ret)
+          {
+             fprintf(stderr, "edje_pick_test: '%s' failed (%d)\n", cmd, ret);
+             goto end;
+          }
+     }
+
+   for (i = 0; i < 2; i++)
+     {
+        snprintf(out[i], sizeof(out[i]), "%s/out_%d.edj", dir, i);
+        snprintf(cmd, sizeof(cmd),
+              "'%s' --reproducible --jobs %d -o '%s' -a '%s' -a '%s' "
+              "> /dev/null", edje_pick, i ? 4 : 1, out[i], edj[0], edj[1]);
+        ret = _test_run(cmd);
+        if (ret)
+          {
+             fprintf(stderr, "edje_pick_test: '%s' failed (%d)\n", cmd, ret);
+             goto end;
+          }
+
+        data[i] = _test_file_read(out[i], &size[i]);
+        if (!data[i])
+          {
+             fprintf(stderr, "edje_pick_test: failed to read '%s'\n", out[i]);
+             goto end;
+          }
+     }
+
+   if ((size[0] == size[1]) && (!memcmp(data[0], data[1], size[0])))
+     status = 0;
+   else
+     fprintf(stderr, "edje_pick_test: --reproducible outputs differ "
+           "(%zu and %zu bytes)\n", size[0], size[1]);
+
+end:
+   free(data[0]);
+   free(data[1]);
+   snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+   if (_test_run(cmd))
+     fprintf(stderr, "edje_pick_test: failed to remove '%s'\n", dir);
+
+   return status;
+}